@@ -0,0 +1,148 @@
+// Capture archive scan: pread vs. mmap vs. io_uring, cold and warm page cache.
+// Every block is decoded and applied to a channel state tracker, so io_uring
+// can overlap its reads with real work.
+//
+//   bench_capture [file] [size_mb] [queue_depth] [block_kb]
+//
+// The file is created with synthetic traffic if it does not exist. "cold"
+// drops the file from the page cache with POSIX_FADV_DONTNEED first (works
+// without root for clean pages).
+// Output: one line per run, "io cache MB/s records/s messages".
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "capture_reader.h"
+
+static int create_capture(const char* path, uint64_t size) {
+    FILE* file = fopen(path, "wb");
+    if(!file) return -1;
+
+    MidiCaptureHeader header = {
+        .version = MIDI_CAPTURE_VERSION,
+        .record_size = MIDI_CAPTURE_RECORD_SIZE,
+        .tick_hz = 1000,
+        .start_time = 0,
+    };
+    uint8_t raw[MIDI_CAPTURE_HEADER_SIZE];
+    midi_capture_header_encode(&header, raw);
+    fwrite(raw, 1, sizeof(raw), file);
+
+    uint32_t lfsr = 0xACE1u;
+    uint64_t records = (size - MIDI_CAPTURE_HEADER_SIZE) / MIDI_CAPTURE_RECORD_SIZE;
+    for(uint64_t i = 0; i < records; i++) {
+        lfsr = (lfsr >> 1) ^ (-(lfsr & 1u) & 0xB400u);
+        uint8_t ch = lfsr & 0x0F;
+        uint8_t packet[4] = {0x09, 0x90 | ch, (lfsr >> 4) & 0x7F, (lfsr >> 8) & 0x7F};
+        switch(i % 4) {
+        case 1:
+            packet[0] = 0x08;
+            packet[1] = 0x80 | ch;
+            break;
+        case 2:
+            packet[0] = 0x0B;
+            packet[1] = 0xB0 | ch;
+            break;
+        case 3:
+            packet[0] = 0x0E;
+            packet[1] = 0xE0 | ch;
+            break;
+        }
+        uint8_t record[MIDI_CAPTURE_RECORD_SIZE];
+        midi_capture_record_encode((uint32_t)(i / 4), packet, record);
+        fwrite(record, 1, sizeof(record), file);
+    }
+    return fclose(file);
+}
+
+static void drop_cache(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int scan(const char* path, MidiCaptureReaderConfig* config, const char* cache) {
+    static MidiChannelState state;
+    static uint8_t sysex[256];
+    MidiDecoder decoder;
+    MidiMessage out[256];
+
+    midi_state_reset(&state);
+    midi_decoder_init(&decoder, sysex, sizeof(sysex));
+
+    double start = now();
+    MidiCaptureReader* reader = midi_capture_reader_open(path, config);
+    if(!reader) {
+        perror(path);
+        return -1;
+    }
+
+    uint64_t bytes = 0;
+    uint64_t messages = 0;
+    const uint8_t* data;
+    ssize_t length;
+    while((length = midi_capture_reader_next(reader, &data)) > 0) {
+        bytes += (uint64_t)length;
+        while(length > 0) {
+            size_t consumed = 0;
+            size_t count = midi_capture_decode_records(
+                &decoder, data, (size_t)length, out, sizeof(out) / sizeof(out[0]), &consumed);
+            midi_state_apply_batch(&state, out, count);
+            messages += count;
+            data += consumed;
+            length -= (ssize_t)consumed;
+        }
+    }
+    if(length < 0) perror("read");
+
+    double elapsed = now() - start;
+    printf("%-9s %-5s %10.1f %12.0f %10llu\n",
+           midi_capture_io_name(midi_capture_reader_io(reader)), cache, bytes / elapsed / 1e6,
+           bytes / MIDI_CAPTURE_RECORD_SIZE / elapsed, (unsigned long long)messages);
+    midi_capture_reader_close(reader);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "/tmp/mitzi_bench.mcap";
+    uint64_t size = (argc > 2 ? strtoull(argv[2], NULL, 0) : 128) << 20;
+    unsigned queue_depth = argc > 3 ? (unsigned)strtoul(argv[3], NULL, 0) : 8;
+    size_t block = (argc > 4 ? strtoul(argv[4], NULL, 0) : 256) << 10;
+
+    struct stat st;
+    if(stat(path, &st) != 0 || (uint64_t)st.st_size != MIDI_CAPTURE_HEADER_SIZE +
+                                   (size - MIDI_CAPTURE_HEADER_SIZE) / MIDI_CAPTURE_RECORD_SIZE *
+                                       MIDI_CAPTURE_RECORD_SIZE) {
+        if(create_capture(path, size) != 0) {
+            perror(path);
+            return 1;
+        }
+    }
+
+    printf("%-9s %-5s %10s %12s %10s\n", "io", "cache", "MB/s", "records/s", "messages");
+    MidiCaptureIo backends[] = {MidiCaptureIoPread, MidiCaptureIoMmap, MidiCaptureIoUring};
+    for(size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        MidiCaptureReaderConfig config = {
+            .io = backends[i],
+            .queue_depth = queue_depth,
+            .block_size = block,
+        };
+        drop_cache(path);
+        if(scan(path, &config, "cold") != 0) return 1;
+        if(scan(path, &config, "warm") != 0) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+// Decoder + state tracker throughput: per-message callbacks vs. batch APIs.
+// Output: one line per variant, "name messages_per_second ns_per_message".
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+#include "midi_core.hpp"
+
+namespace {
+
+constexpr std::size_t kPackets = 1 << 20;
+constexpr int kRuns = 7;
+constexpr std::size_t kBatch = 64;
+
+// Typical controller traffic: notes, CC sweeps, pitch bend and an occasional SysEx
+std::vector<std::uint8_t> make_stream() {
+    std::vector<std::uint8_t> data;
+    data.reserve(kPackets * MIDI_USB_PACKET_SIZE);
+    std::uint32_t lfsr = 0xACE1u;
+    for(std::size_t i = 0; i < kPackets; i++) {
+        lfsr = (lfsr >> 1) ^ (-(lfsr & 1u) & 0xB400u);
+        std::uint8_t ch = lfsr & 0x0F;
+        std::uint8_t a = (lfsr >> 4) & 0x7F;
+        std::uint8_t b = (lfsr >> 8) & 0x7F;
+        if(i % 256 == 0) {
+            // F0 41 10 42 12 00 01 02 03 F7 split into four packets
+            const std::uint8_t sysex[] = {0x04, 0xF0, 0x41, 0x10, 0x04, 0x42, 0x12, 0x00,
+                                          0x04, 0x01, 0x02, 0x03, 0x05, 0xF7, 0x00, 0x00};
+            data.insert(data.end(), sysex, sysex + sizeof(sysex));
+            i += 3;
+            continue;
+        }
+        switch(i % 4) {
+        case 0: data.insert(data.end(), {0x09, std::uint8_t(0x90 | ch), a, b}); break;
+        case 1: data.insert(data.end(), {0x08, std::uint8_t(0x80 | ch), a, 0}); break;
+        case 2: data.insert(data.end(), {0x0B, std::uint8_t(0xB0 | ch), a, b}); break;
+        default: data.insert(data.end(), {0x0E, std::uint8_t(0xE0 | ch), a, b}); break;
+        }
+    }
+    return data;
+}
+
+struct CallbackCtx {
+    MidiChannelState* state;
+    std::size_t count;
+};
+
+void on_message(const MidiMessage* message, void* ctx) {
+    auto* c = static_cast<CallbackCtx*>(ctx);
+    midi_state_apply(c->state, message);
+    c->count++;
+}
+
+template <typename F>
+void run(const char* name, F&& body) {
+    double best = 1e30;
+    std::size_t messages = 0;
+    for(int r = 0; r < kRuns; r++) {
+        auto start = std::chrono::steady_clock::now();
+        messages = body();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if(elapsed.count() < best) best = elapsed.count();
+    }
+    std::printf("%-16s %12.0f %8.2f\n", name, messages / best, best * 1e9 / messages);
+}
+
+} // namespace
+
+int main() {
+    const std::vector<std::uint8_t> stream = make_stream();
+    static MidiChannelState state;
+    MidiDecoder decoder;
+    std::uint8_t sysex[256];
+    midi_decoder_init(&decoder, sysex, sizeof(sysex));
+
+    std::printf("%-16s %12s %8s\n", "variant", "msg/s", "ns/msg");
+
+    run("callback", [&] {
+        midi_state_reset(&state);
+        CallbackCtx ctx = {&state, 0};
+        midi_decode_packets_cb(&decoder, stream.data(), stream.size(), 0, on_message, &ctx);
+        return ctx.count;
+    });
+
+    run("batch", [&] {
+        midi_state_reset(&state);
+        MidiMessage out[kBatch];
+        std::size_t total = 0;
+        const std::uint8_t* data = stream.data();
+        std::size_t length = stream.size();
+        while(length >= MIDI_USB_PACKET_SIZE) {
+            std::size_t consumed = 0;
+            std::size_t count = midi_decode_packets(&decoder, data, length, 0, out, kBatch, &consumed);
+            midi_state_apply_batch(&state, out, count);
+            total += count;
+            data += consumed;
+            length -= consumed;
+        }
+        return total;
+    });
+
+    mitzi::Decoder cpp_decoder;
+    mitzi::ChannelState cpp_state;
+    run("batch (c++ span)", [&] {
+        cpp_state.reset();
+        MidiMessage out[kBatch];
+        std::size_t total = 0;
+        std::span<const std::uint8_t> input(stream);
+        while(input.size() >= MIDI_USB_PACKET_SIZE) {
+            auto messages = cpp_decoder.decode(input, out);
+            cpp_state.apply(messages);
+            total += messages.size();
+        }
+        return total;
+    });
+
+    return 0;
+}
@@ -0,0 +1,588 @@
+// Record walk throughput of the history and capture stores.
+//
+//   bench_scan [--json] [records ...]
+//
+// Operations, each over the records oldest to newest:
+//   seq     - sequential scan touching every field
+//   filter  - sequential scan counting Note On on channel 10
+//   random  - lookups by logical index (xorshift sequence)
+// Stores and record layouts:
+//   ring/message  - ring of MidiMessage (what the app history keeps)
+//   ring/packed8  - ring of 8-byte capture records (timestamp + USB packet)
+//   ring/soa      - ring as separate timestamp/status/data arrays
+//   compressed    - blocks of running-status bytes + varint time deltas with a
+//                   block index for random access (candidate tier for long histories)
+//   capture/<io>  - .mcap file through capture_reader (pread, mmap, io_uring);
+//                   (random access: one pread per record, reported as capture/pread)
+//                   Opening the file and the reader (io_uring ring setup, buffer
+//                   registration) is not timed, only the walk over the records.
+// Full rings start in the middle of their buffer, so scans cross the wrap.
+// Default sizes: 4 Ki (cache), 64 Ki and 1 Mi records.
+//
+// Output: CSV (or JSON lines with --json), one row per store/layout/size/op:
+// store,layout,record_bytes,records,op,records_per_s,ns_per_record,checksum
+// All layouts of one size must agree on the checksum; exit status 1 if not.
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "capture_reader.h"
+
+#define COMPRESSED_BLOCK 128 // Records per block in the compressed tier
+#define FILTER_STATUS 0x99   // Note On, channel 10
+#define MIN_SECONDS 0.2      // Repeat each operation at least this long
+#define MIN_RUNS 3
+#define CAPTURE_RANDOM_MAX 200000 // pread per lookup: cap the count
+#define CAPTURE_PATH "/tmp/mitzi_scan.mcap"
+
+typedef enum {
+    OpSeq,
+    OpFilter,
+    OpRandom,
+    OpCount,
+} Op;
+
+static const char* const op_names[OpCount] = {"seq", "filter", "random"};
+
+typedef struct {
+    const char* store;
+    const char* layout;
+    size_t record_bytes;
+    // Returns the checksum; records is the number of records visited
+    uint64_t (*run)(void* context, Op op, size_t* records);
+    void* context;
+    // Optional, around each run and outside the timing: setup that is not part of the walk
+    bool (*prepare)(void* context, Op op);
+    void (*finish)(void* context);
+} Subject;
+
+static bool json;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t random_next(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static uint8_t data_length(uint8_t status) {
+    switch(status & 0xF0) {
+    case 0xC0:
+    case 0xD0:
+        return 1;
+    case 0xF0:
+        return 0;
+    default:
+        return 2;
+    }
+}
+
+// Traffic like bench_capture: notes, CC and pitch bend, a program change now and then
+static void make_traffic(MidiMessage* out, size_t count) {
+    uint32_t lfsr = 0xACE1u;
+    uint32_t timestamp = 0;
+    for(size_t i = 0; i < count; i++) {
+        lfsr = (lfsr >> 1) ^ (-(lfsr & 1u) & 0xB400u);
+        uint8_t channel = lfsr & 0x0F;
+        static const uint8_t types[] = {0x90, 0x80, 0xB0, 0xE0};
+        uint8_t type = (i % 64 == 63) ? 0xC0 : types[i % 4];
+        timestamp += (lfsr >> 12) & 0x03;
+
+        MidiMessage* m = &out[i];
+        memset(m, 0, sizeof(MidiMessage));
+        m->status = type | channel;
+        midi_parse_status(m->status, &m->type, &m->channel);
+        m->data1 = (lfsr >> 4) & 0x7F;
+        m->data2 = data_length(m->status) == 2 ? (lfsr >> 8) & 0x7F : 0;
+        m->timestamp = timestamp;
+    }
+}
+
+static uint32_t get_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// The same checksum for every layout: fields of the record at logical index i
+#define ACCUMULATE(op, sum, timestamp, status, data1, data2)          \
+    do {                                                              \
+        if((op) == OpFilter) {                                        \
+            if((status) == FILTER_STATUS && (data2) != 0) {           \
+                (sum) += (timestamp);                                 \
+            }                                                         \
+        } else if((op) == OpRandom) {                                 \
+            (sum) += (timestamp) + (data1);                           \
+        } else {                                                      \
+            (sum) += (timestamp) + (status) + (data1) + (data2);      \
+        }                                                             \
+    } while(0)
+
+// --- Rings -------------------------------------------------------------------
+
+typedef struct {
+    size_t count;    // Records stored (oldest first from tail)
+    size_t capacity; // Power of two
+    size_t tail;     // Physical index of the oldest record
+    MidiMessage* message;
+    uint8_t* packed;  // 8 bytes per record
+    uint32_t* timestamp;
+    uint8_t* status;
+    uint8_t* data1;
+    uint8_t* data2;
+} Ring;
+
+static void ring_init(Ring* ring, const MidiMessage* messages, size_t count) {
+    memset(ring, 0, sizeof(Ring));
+    ring->capacity = 1;
+    while(ring->capacity < count) ring->capacity <<= 1;
+    ring->count = count;
+    // The oldest record sits in the middle, so full rings wrap halfway through
+    ring->tail = ring->capacity / 2;
+
+    ring->message = calloc(ring->capacity, sizeof(MidiMessage));
+    ring->packed = calloc(ring->capacity, MIDI_CAPTURE_RECORD_SIZE);
+    ring->timestamp = calloc(ring->capacity, sizeof(uint32_t));
+    ring->status = calloc(ring->capacity, 1);
+    ring->data1 = calloc(ring->capacity, 1);
+    ring->data2 = calloc(ring->capacity, 1);
+
+    for(size_t i = 0; i < count; i++) {
+        size_t p = (ring->tail + i) & (ring->capacity - 1);
+        const MidiMessage* m = &messages[i];
+        ring->message[p] = *m;
+        uint8_t packet[MIDI_USB_PACKET_SIZE] = {m->status >> 4, m->status, m->data1, m->data2};
+        midi_capture_record_encode(m->timestamp, packet, &ring->packed[p * MIDI_CAPTURE_RECORD_SIZE]);
+        ring->timestamp[p] = m->timestamp;
+        ring->status[p] = m->status;
+        ring->data1[p] = m->data1;
+        ring->data2[p] = m->data2;
+    }
+}
+
+static void ring_free(Ring* ring) {
+    free(ring->message);
+    free(ring->packed);
+    free(ring->timestamp);
+    free(ring->status);
+    free(ring->data1);
+    free(ring->data2);
+}
+
+// Walks go over the two contiguous segments instead of masking every index
+#define RING_WALK(ring, body)                                                   \
+    do {                                                                        \
+        size_t first = (ring)->capacity - (ring)->tail;                         \
+        if(first > (ring)->count) first = (ring)->count;                        \
+        size_t segments[2][2] = {{(ring)->tail, first}, {0, (ring)->count - first}}; \
+        for(int s = 0; s < 2; s++) {                                            \
+            size_t end = segments[s][0] + segments[s][1];                       \
+            for(size_t p = segments[s][0]; p < end; p++) {                      \
+                body;                                                           \
+            }                                                                   \
+        }                                                                       \
+    } while(0)
+
+#define RING_RANDOM(ring, body)                                                 \
+    do {                                                                        \
+        uint32_t state = 0x9E3779B9u;                                           \
+        size_t mask = (ring)->capacity - 1;                                     \
+        for(size_t n = 0; n < (ring)->count; n++) {                             \
+            size_t p = ((ring)->tail + random_next(&state) % (ring)->count) & mask; \
+            body;                                                               \
+        }                                                                       \
+    } while(0)
+
+static uint64_t ring_message_run(void* context, Op op, size_t* records) {
+    const Ring* ring = context;
+    uint64_t sum = 0;
+    const MidiMessage* m = ring->message;
+    if(op == OpRandom) {
+        RING_RANDOM(ring, ACCUMULATE(op, sum, m[p].timestamp, m[p].status, m[p].data1, m[p].data2));
+    } else if(op == OpFilter) {
+        // Uses the decoded fields the history keeps
+        RING_WALK(ring, if(m[p].type == MidiNoteOn && m[p].channel == (FILTER_STATUS & 0x0F)) {
+            ACCUMULATE(op, sum, m[p].timestamp, m[p].status, m[p].data1, m[p].data2);
+        });
+    } else {
+        RING_WALK(ring, ACCUMULATE(op, sum, m[p].timestamp, m[p].status, m[p].data1, m[p].data2));
+    }
+    *records = ring->count;
+    return sum;
+}
+
+static uint64_t ring_packed_run(void* context, Op op, size_t* records) {
+    const Ring* ring = context;
+    uint64_t sum = 0;
+    const uint8_t* r = ring->packed;
+    if(op == OpRandom) {
+        RING_RANDOM(ring, ACCUMULATE(op, sum, get_le32(&r[p * 8]), r[p * 8 + 5], r[p * 8 + 6], r[p * 8 + 7]));
+    } else {
+        RING_WALK(ring, ACCUMULATE(op, sum, get_le32(&r[p * 8]), r[p * 8 + 5], r[p * 8 + 6], r[p * 8 + 7]));
+    }
+    *records = ring->count;
+    return sum;
+}
+
+static uint64_t ring_soa_run(void* context, Op op, size_t* records) {
+    const Ring* ring = context;
+    uint64_t sum = 0;
+    if(op == OpRandom) {
+        RING_RANDOM(
+            ring,
+            ACCUMULATE(op, sum, ring->timestamp[p], ring->status[p], ring->data1[p], ring->data2[p]));
+    } else if(op == OpFilter) {
+        // Status column first, the other columns only for matches
+        RING_WALK(ring, if(ring->status[p] == FILTER_STATUS) {
+            ACCUMULATE(op, sum, ring->timestamp[p], ring->status[p], ring->data1[p], ring->data2[p]);
+        });
+    } else {
+        RING_WALK(
+            ring,
+            ACCUMULATE(op, sum, ring->timestamp[p], ring->status[p], ring->data1[p], ring->data2[p]));
+    }
+    *records = ring->count;
+    return sum;
+}
+
+// --- Compressed tier ---------------------------------------------------------
+
+// Per record: [status, omitted if unchanged] data bytes [time delta as varint].
+// Each block starts with a full status and its own base timestamp.
+typedef struct {
+    size_t count;
+    uint8_t* bytes;
+    size_t size;
+    uint32_t* block_offset;
+    uint32_t* block_time; // Timestamp before the first record of the block
+} Compressed;
+
+static void compressed_init(Compressed* c, const MidiMessage* messages, size_t count) {
+    size_t blocks = (count + COMPRESSED_BLOCK - 1) / COMPRESSED_BLOCK;
+    c->count = count;
+    c->bytes = malloc(count * 8 + 16);
+    c->block_offset = malloc(blocks * sizeof(uint32_t));
+    c->block_time = malloc(blocks * sizeof(uint32_t));
+
+    size_t o = 0;
+    uint8_t running = 0;
+    uint32_t previous = 0;
+    for(size_t i = 0; i < count; i++) {
+        const MidiMessage* m = &messages[i];
+        if(i % COMPRESSED_BLOCK == 0) {
+            c->block_offset[i / COMPRESSED_BLOCK] = o;
+            c->block_time[i / COMPRESSED_BLOCK] = previous;
+            running = 0;
+        }
+        if(m->status != running) c->bytes[o++] = running = m->status;
+        uint8_t length = data_length(m->status);
+        if(length > 0) c->bytes[o++] = m->data1;
+        if(length > 1) c->bytes[o++] = m->data2;
+        uint32_t delta = m->timestamp - previous;
+        previous = m->timestamp;
+        while(delta >= 0x80) {
+            c->bytes[o++] = (delta & 0x7F) | 0x80;
+            delta >>= 7;
+        }
+        c->bytes[o++] = delta;
+    }
+    c->size = o;
+}
+
+static void compressed_free(Compressed* c) {
+    free(c->bytes);
+    free(c->block_offset);
+    free(c->block_time);
+}
+
+typedef struct {
+    const uint8_t* p;
+    uint8_t status;
+    uint32_t timestamp;
+} CompressedCursor;
+
+static inline void compressed_next(CompressedCursor* cursor, uint8_t* data1, uint8_t* data2) {
+    const uint8_t* p = cursor->p;
+    if(*p & 0x80) cursor->status = *p++;
+    uint8_t length = data_length(cursor->status);
+    *data1 = length > 0 ? *p++ : 0;
+    *data2 = length > 1 ? *p++ : 0;
+    uint32_t delta = 0;
+    for(unsigned shift = 0;; shift += 7) {
+        uint8_t b = *p++;
+        delta |= (uint32_t)(b & 0x7F) << shift;
+        if(!(b & 0x80)) break;
+    }
+    cursor->timestamp += delta;
+    cursor->p = p;
+}
+
+static CompressedCursor compressed_seek(const Compressed* c, size_t block) {
+    CompressedCursor cursor = {
+        .p = &c->bytes[c->block_offset[block]],
+        .status = 0,
+        .timestamp = c->block_time[block],
+    };
+    return cursor;
+}
+
+static uint64_t compressed_run(void* context, Op op, size_t* records) {
+    const Compressed* c = context;
+    uint64_t sum = 0;
+    uint8_t data1;
+    uint8_t data2;
+
+    if(op == OpRandom) {
+        uint32_t state = 0x9E3779B9u;
+        for(size_t n = 0; n < c->count; n++) {
+            size_t i = random_next(&state) % c->count;
+            CompressedCursor cursor = compressed_seek(c, i / COMPRESSED_BLOCK);
+            for(size_t k = 0; k <= i % COMPRESSED_BLOCK; k++) compressed_next(&cursor, &data1, &data2);
+            ACCUMULATE(op, sum, cursor.timestamp, cursor.status, data1, data2);
+        }
+    } else {
+        CompressedCursor cursor = compressed_seek(c, 0);
+        for(size_t i = 0; i < c->count; i++) {
+            compressed_next(&cursor, &data1, &data2);
+            ACCUMULATE(op, sum, cursor.timestamp, cursor.status, data1, data2);
+        }
+    }
+    *records = c->count;
+    return sum;
+}
+
+// --- Capture files -----------------------------------------------------------
+
+typedef struct {
+    const char* path;
+    size_t count;
+    MidiCaptureIo io;
+    FILE* file;                // Random access, open between prepare and finish
+    MidiCaptureReader* reader; // Scans, open between prepare and finish
+} Capture;
+
+static int capture_write(const char* path, const MidiMessage* messages, size_t count) {
+    FILE* file = fopen(path, "wb");
+    if(!file) return -1;
+
+    MidiCaptureHeader header = {
+        .version = MIDI_CAPTURE_VERSION,
+        .record_size = MIDI_CAPTURE_RECORD_SIZE,
+        .tick_hz = 1000,
+        .start_time = 0,
+    };
+    uint8_t raw[MIDI_CAPTURE_HEADER_SIZE];
+    midi_capture_header_encode(&header, raw);
+    fwrite(raw, 1, sizeof(raw), file);
+
+    for(size_t i = 0; i < count; i++) {
+        const MidiMessage* m = &messages[i];
+        uint8_t packet[MIDI_USB_PACKET_SIZE] = {m->status >> 4, m->status, m->data1, m->data2};
+        uint8_t record[MIDI_CAPTURE_RECORD_SIZE];
+        midi_capture_record_encode(m->timestamp, packet, record);
+        fwrite(record, 1, sizeof(record), file);
+    }
+    return fclose(file);
+}
+
+static bool capture_prepare(void* context, Op op) {
+    Capture* capture = context;
+    if(op == OpRandom) {
+        // Random access goes around the reader: one pread per record
+        capture->file = fopen(capture->path, "rb");
+        return capture->file != NULL;
+    }
+    MidiCaptureReaderConfig config = {.io = capture->io};
+    capture->reader = midi_capture_reader_open(capture->path, &config);
+    return capture->reader != NULL;
+}
+
+static void capture_finish(void* context) {
+    Capture* capture = context;
+    if(capture->file) fclose(capture->file);
+    capture->file = NULL;
+    midi_capture_reader_close(capture->reader);
+    capture->reader = NULL;
+}
+
+static uint64_t capture_run(void* context, Op op, size_t* records) {
+    const Capture* capture = context;
+    uint64_t sum = 0;
+    *records = 0;
+
+    if(op == OpRandom) {
+        int fd = fileno(capture->file);
+        size_t lookups = capture->count < CAPTURE_RANDOM_MAX ? capture->count : CAPTURE_RANDOM_MAX;
+        uint32_t state = 0x9E3779B9u;
+        for(size_t n = 0; n < lookups; n++) {
+            size_t i = random_next(&state) % capture->count;
+            uint8_t r[MIDI_CAPTURE_RECORD_SIZE];
+            if(pread(fd, r, sizeof(r), MIDI_CAPTURE_HEADER_SIZE + i * MIDI_CAPTURE_RECORD_SIZE) !=
+               (ssize_t)sizeof(r)) {
+                break;
+            }
+            ACCUMULATE(op, sum, get_le32(r), r[5], r[6], r[7]);
+            (*records)++;
+        }
+    } else {
+        const uint8_t* data;
+        ssize_t length;
+        while((length = midi_capture_reader_next(capture->reader, &data)) > 0) {
+            for(ssize_t o = 0; o + MIDI_CAPTURE_RECORD_SIZE <= length; o += MIDI_CAPTURE_RECORD_SIZE) {
+                const uint8_t* r = &data[o];
+                ACCUMULATE(op, sum, get_le32(r), r[5], r[6], r[7]);
+                (*records)++;
+            }
+        }
+    }
+    return sum;
+}
+
+// --- Driver ------------------------------------------------------------------
+
+static void report(const Subject* subject, size_t count, Op op, double rate, uint64_t checksum) {
+    if(json) {
+        printf(
+            "{\"store\":\"%s\",\"layout\":\"%s\",\"record_bytes\":%zu,\"records\":%zu,"
+            "\"op\":\"%s\",\"records_per_s\":%.0f,\"ns_per_record\":%.3f,\"checksum\":%llu}\n",
+            subject->store,
+            subject->layout,
+            subject->record_bytes,
+            count,
+            op_names[op],
+            rate,
+            1e9 / rate,
+            (unsigned long long)checksum);
+    } else {
+        printf(
+            "%s,%s,%zu,%zu,%s,%.0f,%.3f,%llu\n",
+            subject->store,
+            subject->layout,
+            subject->record_bytes,
+            count,
+            op_names[op],
+            rate,
+            1e9 / rate,
+            (unsigned long long)checksum);
+    }
+    fflush(stdout);
+}
+
+// Best rate over repeated runs
+static double measure(const Subject* subject, Op op, uint64_t* checksum) {
+    double best = 0;
+    double total = 0;
+    for(int run = 0; run < MIN_RUNS || total < MIN_SECONDS; run++) {
+        size_t records = 0;
+        if(subject->prepare && !subject->prepare(subject->context, op)) {
+            perror(subject->layout);
+            return 0;
+        }
+        double start = now();
+        *checksum = subject->run(subject->context, op, &records);
+        double elapsed = now() - start;
+        if(subject->finish) subject->finish(subject->context);
+        total += elapsed;
+        if(elapsed > 0 && records / elapsed > best) best = records / elapsed;
+    }
+    return best;
+}
+
+static int bench_size(size_t count) {
+    MidiMessage* messages = malloc(count * sizeof(MidiMessage));
+    make_traffic(messages, count);
+
+    Ring ring;
+    ring_init(&ring, messages, count);
+    Compressed compressed;
+    compressed_init(&compressed, messages, count);
+    if(capture_write(CAPTURE_PATH, messages, count) != 0) {
+        perror(CAPTURE_PATH);
+        return 1;
+    }
+    Capture captures[] = {
+        {CAPTURE_PATH, count, MidiCaptureIoPread, NULL, NULL},
+        {CAPTURE_PATH, count, MidiCaptureIoMmap, NULL, NULL},
+        {CAPTURE_PATH, count, MidiCaptureIoUring, NULL, NULL},
+    };
+
+    Subject subjects[] = {
+        {"ring", "message", sizeof(MidiMessage), ring_message_run, &ring, NULL, NULL},
+        {"ring", "packed8", MIDI_CAPTURE_RECORD_SIZE, ring_packed_run, &ring, NULL, NULL},
+        {"ring", "soa", sizeof(uint32_t) + 3, ring_soa_run, &ring, NULL, NULL},
+        {"compressed", "varint", 0, compressed_run, &compressed, NULL, NULL},
+        {"capture", "pread", MIDI_CAPTURE_RECORD_SIZE, capture_run, &captures[0], capture_prepare, capture_finish},
+        {"capture", "mmap", MIDI_CAPTURE_RECORD_SIZE, capture_run, &captures[1], capture_prepare, capture_finish},
+        {"capture", "io_uring", MIDI_CAPTURE_RECORD_SIZE, capture_run, &captures[2], capture_prepare, capture_finish},
+    };
+    // Average encoded size, rounded up
+    subjects[3].record_bytes = (compressed.size + count - 1) / count;
+
+    int status = 0;
+    for(Op op = 0; op < OpCount; op++) {
+        uint64_t reference = 0;
+        for(size_t s = 0; s < sizeof(subjects) / sizeof(subjects[0]); s++) {
+            // The reader has no random access: one pread row stands for all backends
+            if(op == OpRandom && subjects[s].run == capture_run &&
+               ((const Capture*)subjects[s].context)->io != MidiCaptureIoPread) {
+                continue;
+            }
+            uint64_t checksum = 0;
+            double rate = measure(&subjects[s], op, &checksum);
+            report(&subjects[s], count, op, rate, checksum);
+            // Capture random access visits fewer records, so its sum differs
+            if(op == OpRandom && subjects[s].run == capture_run) continue;
+            if(s == 0) {
+                reference = checksum;
+            } else if(checksum != reference) {
+                fprintf(
+                    stderr,
+                    "checksum mismatch: %s/%s %s\n",
+                    subjects[s].store,
+                    subjects[s].layout,
+                    op_names[op]);
+                status = 1;
+            }
+        }
+    }
+
+    unlink(CAPTURE_PATH);
+    compressed_free(&compressed);
+    ring_free(&ring);
+    free(messages);
+    return status;
+}
+
+int main(int argc, char** argv) {
+    size_t sizes[16];
+    size_t size_count = 0;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if(size_count < sizeof(sizes) / sizeof(sizes[0])) {
+            sizes[size_count++] = strtoul(argv[i], NULL, 0);
+        }
+    }
+    if(size_count == 0) {
+        sizes[size_count++] = 4096;
+        sizes[size_count++] = 65536;
+        sizes[size_count++] = 1048576;
+    }
+
+    if(!json) printf("store,layout,record_bytes,records,op,records_per_s,ns_per_record,checksum\n");
+    int status = 0;
+    for(size_t i = 0; i < size_count; i++) {
+        if(sizes[i] > 0) status |= bench_size(sizes[i]);
+    }
+    return status;
+}
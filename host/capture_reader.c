@@ -0,0 +1,472 @@
+#define _GNU_SOURCE
+#include "capture_reader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+#define DEFAULT_QUEUE_DEPTH 8
+#define DEFAULT_BLOCK_SIZE (256 * 1024)
+#define MAX_QUEUE_DEPTH 64
+#define BUFFER_ALIGN 4096 // Page, for the registered io_uring buffers
+
+#ifdef __linux__
+// Minimal raw io_uring: one SQ/CQ pair, reads only. No liburing dependency.
+typedef struct {
+    int fd;
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+    bool registered; // Buffers registered, READ_FIXED in use
+} Uring;
+#endif
+
+typedef enum {
+    SlotIdle,
+    SlotPending,
+    SlotDone,
+} SlotState;
+
+typedef struct {
+    SlotState state;
+    uint64_t offset; // File offset of the block
+    size_t length;   // Requested bytes
+    ssize_t result;  // Bytes read or -errno
+} Slot;
+
+struct MidiCaptureReader {
+    int fd;
+    MidiCaptureIo io;
+    MidiCaptureHeader header;
+    uint64_t data_end;   // End of the last whole record
+    uint64_t next_read;  // Next offset to hand out (pread/mmap) or submit (io_uring)
+    size_t block_size;
+
+    // pread / io_uring buffers
+    uint8_t* buffers;
+    unsigned queue_depth;
+
+    // mmap
+    uint8_t* map;
+    size_t map_size;
+
+#ifdef __linux__
+    Uring ring;
+    Slot slots[MAX_QUEUE_DEPTH];
+    struct iovec iov[MAX_QUEUE_DEPTH]; // Only used without registered buffers
+    uint64_t next_block; // Block index handed out next
+    uint64_t blocks;     // Total blocks
+    int held_slot;       // Slot returned by the last call, resubmitted on the next
+    bool primed;         // First reads submitted (by the first next, not by open)
+#endif
+};
+
+const char* midi_capture_io_name(MidiCaptureIo io) {
+    switch(io) {
+    case MidiCaptureIoPread:
+        return "pread";
+    case MidiCaptureIoMmap:
+        return "mmap";
+    case MidiCaptureIoUring:
+        return "io_uring";
+    }
+    return "?";
+}
+
+#ifdef __linux__
+
+static int uring_setup(unsigned entries, struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+static void uring_exit(Uring* ring) {
+    if(ring->sqes) munmap(ring->sqes, ring->sqes_size);
+    if(ring->cq_ring && ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+    if(ring->sq_ring) munmap(ring->sq_ring, ring->sq_ring_size);
+    if(ring->fd >= 0) close(ring->fd);
+    memset(ring, 0, sizeof(Uring));
+    ring->fd = -1;
+}
+
+static bool uring_init(Uring* ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(Uring));
+
+    ring->fd = uring_setup(entries, &params);
+    if(ring->fd < 0) return false;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        if(ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(
+        NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+        IORING_OFF_SQ_RING);
+    if(ring->sq_ring == MAP_FAILED) {
+        ring->sq_ring = NULL;
+        uring_exit(ring);
+        return false;
+    }
+
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(
+            NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ring->fd, IORING_OFF_CQ_RING);
+        if(ring->cq_ring == MAP_FAILED) {
+            ring->cq_ring = NULL;
+            uring_exit(ring);
+            return false;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(
+        NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+        IORING_OFF_SQES);
+    if(ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        uring_exit(ring);
+        return false;
+    }
+
+    uint8_t* sq = ring->sq_ring;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+
+    uint8_t* cq = ring->cq_ring;
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return true;
+}
+
+static void uring_submit_read(MidiCaptureReader* reader, int slot_index) {
+    Uring* ring = &reader->ring;
+    Slot* slot = &reader->slots[slot_index];
+    uint8_t* buffer = reader->buffers + (size_t)slot_index * reader->block_size;
+
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = reader->fd;
+    sqe->off = slot->offset;
+    sqe->user_data = (uint64_t)slot_index;
+    if(ring->registered) {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->addr = (uint64_t)(uintptr_t)buffer;
+        sqe->len = (uint32_t)slot->length;
+        sqe->buf_index = (uint16_t)slot_index;
+    } else {
+        // READV is available as long as READ_FIXED (5.1); the iovec must outlive the request
+        struct iovec* iov = &reader->iov[slot_index];
+        iov->iov_base = buffer;
+        iov->iov_len = slot->length;
+        sqe->opcode = IORING_OP_READV;
+        sqe->addr = (uint64_t)(uintptr_t)iov;
+        sqe->len = 1;
+    }
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    slot->state = SlotPending;
+    // If this fails (e.g. EAGAIN) the entry stays queued and uring_wait() submits it again
+    uring_enter(ring->fd, 1, 0, 0);
+}
+
+// Reap completions until the given slot is done
+static int uring_wait(MidiCaptureReader* reader, int slot_index) {
+    Uring* ring = &reader->ring;
+
+    while(reader->slots[slot_index].state != SlotDone) {
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        if(head == tail) {
+            unsigned unsubmitted = *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+            if(uring_enter(ring->fd, unsubmitted, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR &&
+               errno != EAGAIN) {
+                return -errno;
+            }
+            continue;
+        }
+        struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+        Slot* done = &reader->slots[cqe->user_data];
+        done->result = cqe->res;
+        done->state = SlotDone;
+        __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+static void uring_queue_block(MidiCaptureReader* reader, int slot_index) {
+    Slot* slot = &reader->slots[slot_index];
+    slot->offset = reader->next_read;
+    slot->length = reader->block_size;
+    if(slot->offset + slot->length > reader->data_end) {
+        slot->length = (size_t)(reader->data_end - slot->offset);
+    }
+    reader->next_read += slot->length;
+    uring_submit_read(reader, slot_index);
+}
+
+static bool uring_start(MidiCaptureReader* reader) {
+    if(!uring_init(&reader->ring, reader->queue_depth)) return false;
+
+    struct iovec iov[MAX_QUEUE_DEPTH];
+    for(unsigned i = 0; i < reader->queue_depth; i++) {
+        iov[i].iov_base = reader->buffers + (size_t)i * reader->block_size;
+        iov[i].iov_len = reader->block_size;
+    }
+    // Registration pins the buffers; it can fail under a low RLIMIT_MEMLOCK
+    reader->ring.registered =
+        uring_register(reader->ring.fd, IORING_REGISTER_BUFFERS, iov, reader->queue_depth) == 0;
+
+    uint64_t data = reader->data_end - MIDI_CAPTURE_HEADER_SIZE;
+    reader->blocks = (data + reader->block_size - 1) / reader->block_size;
+    reader->next_block = 0;
+    reader->held_slot = -1;
+    reader->primed = false;
+    return true;
+}
+
+static ssize_t uring_next(MidiCaptureReader* reader, const uint8_t** data) {
+    // Opening only sets up the ring: reads start with the first block asked for
+    if(!reader->primed) {
+        for(unsigned i = 0; i < reader->queue_depth && i < reader->blocks; i++) {
+            uring_queue_block(reader, (int)i);
+        }
+        reader->primed = true;
+    }
+    // The block handed out last time is consumed now, reuse its buffer
+    if(reader->held_slot >= 0) {
+        if(reader->next_read < reader->data_end) {
+            uring_queue_block(reader, reader->held_slot);
+        } else {
+            reader->slots[reader->held_slot].state = SlotIdle;
+        }
+        reader->held_slot = -1;
+    }
+    if(reader->next_block >= reader->blocks) return 0;
+
+    int slot_index = (int)(reader->next_block % reader->queue_depth);
+    int ret = uring_wait(reader, slot_index);
+    if(ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+
+    Slot* slot = &reader->slots[slot_index];
+    uint8_t* buffer = reader->buffers + (size_t)slot_index * reader->block_size;
+    if(slot->result < 0) {
+        errno = (int)-slot->result;
+        return -1;
+    }
+    // Short read: complete the block synchronously
+    size_t have = (size_t)slot->result;
+    while(have < slot->length) {
+        ssize_t n = pread(reader->fd, buffer + have, slot->length - have, (off_t)(slot->offset + have));
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return n < 0 ? -1 : 0;
+        have += (size_t)n;
+    }
+
+    reader->next_block++;
+    reader->held_slot = slot_index;
+    *data = buffer;
+    return (ssize_t)slot->length;
+}
+
+#endif // __linux__
+
+MidiCaptureReader* midi_capture_reader_open(const char* path, const MidiCaptureReaderConfig* config) {
+    MidiCaptureReaderConfig defaults = {.io = MidiCaptureIoPread};
+    if(!config) config = &defaults;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return NULL;
+
+    MidiCaptureReader* reader = calloc(1, sizeof(MidiCaptureReader));
+    if(!reader) {
+        close(fd);
+        return NULL;
+    }
+    reader->fd = fd;
+    reader->io = config->io;
+    reader->queue_depth = config->queue_depth ? config->queue_depth : DEFAULT_QUEUE_DEPTH;
+    if(reader->queue_depth > MAX_QUEUE_DEPTH) reader->queue_depth = MAX_QUEUE_DEPTH;
+    reader->block_size = config->block_size ? config->block_size : DEFAULT_BLOCK_SIZE;
+    reader->block_size -= reader->block_size % MIDI_CAPTURE_RECORD_SIZE;
+    if(reader->block_size == 0) reader->block_size = MIDI_CAPTURE_RECORD_SIZE;
+#ifdef __linux__
+    reader->ring.fd = -1;
+#endif
+
+    uint8_t raw[MIDI_CAPTURE_HEADER_SIZE];
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        int error = errno;
+        midi_capture_reader_close(reader);
+        errno = error;
+        return NULL;
+    }
+    if(pread(fd, raw, sizeof(raw), 0) != (ssize_t)sizeof(raw) ||
+       !midi_capture_header_decode(raw, &reader->header)) {
+        midi_capture_reader_close(reader);
+        errno = EINVAL;
+        return NULL;
+    }
+    uint64_t records = ((uint64_t)st.st_size - MIDI_CAPTURE_HEADER_SIZE) / MIDI_CAPTURE_RECORD_SIZE;
+    reader->data_end = MIDI_CAPTURE_HEADER_SIZE + records * MIDI_CAPTURE_RECORD_SIZE;
+    reader->next_read = MIDI_CAPTURE_HEADER_SIZE;
+
+    // Small files: no block larger than the data, no more buffers than blocks
+    uint64_t data = records * MIDI_CAPTURE_RECORD_SIZE;
+    if(data > 0 && data < reader->block_size) reader->block_size = (size_t)data;
+    uint64_t blocks = data > 0 ? (data + reader->block_size - 1) / reader->block_size : 1;
+    if(reader->queue_depth > blocks) reader->queue_depth = (unsigned)blocks;
+
+#ifndef __linux__
+    if(reader->io == MidiCaptureIoUring) reader->io = MidiCaptureIoPread;
+#endif
+
+    if(reader->io == MidiCaptureIoMmap) {
+        reader->map_size = (size_t)st.st_size;
+        if(reader->map_size > 0) {
+            reader->map = mmap(NULL, reader->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(reader->map == MAP_FAILED) {
+                reader->map = NULL;
+                midi_capture_reader_close(reader);
+                return NULL;
+            }
+            madvise(reader->map, reader->map_size, MADV_SEQUENTIAL);
+        }
+        return reader;
+    }
+
+    unsigned buffers = reader->io == MidiCaptureIoUring ? reader->queue_depth : 1;
+    // aligned_alloc wants a multiple of the alignment, block_size need not be one
+    size_t size = (size_t)buffers * reader->block_size;
+    reader->buffers = aligned_alloc(BUFFER_ALIGN, (size + BUFFER_ALIGN - 1) & ~(size_t)(BUFFER_ALIGN - 1));
+    if(!reader->buffers) {
+        midi_capture_reader_close(reader);
+        return NULL;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+#ifdef __linux__
+    if(reader->io == MidiCaptureIoUring && !uring_start(reader)) {
+        // Kernel without io_uring (< 5.1) or blocked by seccomp
+        reader->io = MidiCaptureIoPread;
+    }
+#endif
+
+    return reader;
+}
+
+void midi_capture_reader_close(MidiCaptureReader* reader) {
+    if(!reader) return;
+#ifdef __linux__
+    if(reader->io == MidiCaptureIoUring) {
+        // Drain reads still in flight before their buffers go away
+        for(unsigned i = 0; i < reader->queue_depth; i++) {
+            if(reader->slots[i].state == SlotPending) uring_wait(reader, (int)i);
+        }
+    }
+    if(reader->ring.fd >= 0) uring_exit(&reader->ring);
+#endif
+    if(reader->map) munmap(reader->map, reader->map_size);
+    free(reader->buffers);
+    if(reader->fd >= 0) close(reader->fd);
+    free(reader);
+}
+
+const MidiCaptureHeader* midi_capture_reader_header(const MidiCaptureReader* reader) {
+    return &reader->header;
+}
+
+MidiCaptureIo midi_capture_reader_io(const MidiCaptureReader* reader) {
+    return reader->io;
+}
+
+uint64_t midi_capture_reader_records(const MidiCaptureReader* reader) {
+    return (reader->data_end - MIDI_CAPTURE_HEADER_SIZE) / MIDI_CAPTURE_RECORD_SIZE;
+}
+
+ssize_t midi_capture_reader_next(MidiCaptureReader* reader, const uint8_t** data) {
+    switch(reader->io) {
+    case MidiCaptureIoMmap: {
+        if(reader->next_read >= reader->data_end) return 0;
+        size_t length = reader->block_size;
+        if(reader->next_read + length > reader->data_end) {
+            length = (size_t)(reader->data_end - reader->next_read);
+        }
+        *data = reader->map + reader->next_read;
+        reader->next_read += length;
+        return (ssize_t)length;
+    }
+
+#ifdef __linux__
+    case MidiCaptureIoUring:
+        return uring_next(reader, data);
+#endif
+
+    default: {
+        if(reader->next_read >= reader->data_end) return 0;
+        size_t length = reader->block_size;
+        if(reader->next_read + length > reader->data_end) {
+            length = (size_t)(reader->data_end - reader->next_read);
+        }
+        size_t have = 0;
+        while(have < length) {
+            ssize_t n = pread(reader->fd, reader->buffers + have, length - have, (off_t)(reader->next_read + have));
+            if(n < 0 && errno == EINTR) continue;
+            if(n < 0) return -1;
+            if(n == 0) break;
+            have += (size_t)n;
+        }
+        have -= have % MIDI_CAPTURE_RECORD_SIZE;
+        reader->next_read += have;
+        *data = reader->buffers;
+        return (ssize_t)have;
+    }
+    }
+}
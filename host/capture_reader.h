@@ -0,0 +1,55 @@
+#pragma once
+
+// Sequential reader for capture files (midi_capture.h) on the host.
+//
+// Three I/O backends:
+//   pread    - one synchronous read per block
+//   mmap     - the file is mapped, blocks point into the mapping
+//   io_uring - up to queue_depth reads in flight into registered buffers, so
+//              slow storage can keep streaming while the caller decodes
+//              (Linux only; no faster than pread when decoding is the bottleneck)
+// io_uring falls back to pread when the kernel (or a seccomp filter) does not
+// provide it; midi_capture_reader_io() tells which backend is in use.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "midi_capture.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    MidiCaptureIoPread,
+    MidiCaptureIoMmap,
+    MidiCaptureIoUring,
+} MidiCaptureIo;
+
+typedef struct {
+    MidiCaptureIo io;
+    unsigned queue_depth; // io_uring reads in flight, 0 = default (8), at most the file's blocks
+    size_t block_size;    // Bytes per read, rounded down to whole records, 0 = default (256 KiB),
+                          // at most the file's data
+} MidiCaptureReaderConfig;
+
+typedef struct MidiCaptureReader MidiCaptureReader;
+
+// Returns NULL and sets errno on failure (EINVAL for a bad header)
+MidiCaptureReader* midi_capture_reader_open(const char* path, const MidiCaptureReaderConfig* config);
+void midi_capture_reader_close(MidiCaptureReader* reader);
+
+const MidiCaptureHeader* midi_capture_reader_header(const MidiCaptureReader* reader);
+MidiCaptureIo midi_capture_reader_io(const MidiCaptureReader* reader);
+const char* midi_capture_io_name(MidiCaptureIo io);
+// Number of whole records in the file
+uint64_t midi_capture_reader_records(const MidiCaptureReader* reader);
+
+// Next block of whole records in file order. *data stays valid until the next
+// call. Returns the block length in bytes, 0 at end of file, -1 on error (errno).
+ssize_t midi_capture_reader_next(MidiCaptureReader* reader, const uint8_t** data);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,122 @@
+#pragma once
+
+// C++ wrapper around the portable MIDI core (midi_core.h) for host tools.
+// Owns the SysEx buffer (RAII) and works on std::span views, no copies.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "midi_core.h"
+
+namespace mitzi {
+
+class Decoder {
+public:
+    explicit Decoder(std::size_t sysex_capacity = 256)
+        : sysex_(sysex_capacity) {
+        midi_decoder_init(&decoder_, sysex_.data(), sysex_.size());
+    }
+
+    Decoder(const Decoder&) = delete;
+    Decoder& operator=(const Decoder&) = delete;
+    // decoder_ points into sysex_: rebind it to the moved buffer, and leave the
+    // source decoding without one (SysEx reported, not stored) instead of
+    // writing into a buffer it no longer owns
+    Decoder(Decoder&& other) noexcept
+        : sysex_(std::move(other.sysex_))
+        , decoder_(other.decoder_) {
+        decoder_.sysex.buffer = sysex_.data();
+        other.release();
+    }
+
+    Decoder& operator=(Decoder&& other) noexcept {
+        if(this != &other) {
+            sysex_ = std::move(other.sysex_);
+            decoder_ = other.decoder_;
+            decoder_.sysex.buffer = sysex_.data();
+            other.release();
+        }
+        return *this;
+    }
+
+    // Decode packets from the front of input into out, advance input past the
+    // consumed bytes and return the filled part of out. Stops after a complete
+    // SysEx, which is then available through sysex().
+    std::span<MidiMessage>
+        decode(std::span<const std::uint8_t>& input, std::span<MidiMessage> out, std::uint32_t timestamp = 0) {
+        std::size_t consumed = 0;
+        std::size_t count = midi_decode_packets(
+            &decoder_, input.data(), input.size(), timestamp, out.data(), out.size(), &consumed);
+        input = input.subspan(consumed);
+        return out.first(count);
+    }
+
+    std::span<const std::uint8_t> sysex() const {
+        std::size_t length = 0;
+        const std::uint8_t* data = midi_decoder_sysex(&decoder_, &length);
+        return {data, length};
+    }
+
+    // The last message decoded is a completed SysEx, see sysex()
+    bool sysex_done() const {
+        return decoder_.sysex_done;
+    }
+
+    bool sysex_truncated() const {
+        return decoder_.sysex.overflow;
+    }
+
+    void reset() {
+        midi_decoder_reset(&decoder_);
+    }
+
+    MidiDecoder* get() {
+        return &decoder_;
+    }
+
+private:
+    void release() noexcept {
+        sysex_.clear();
+        midi_decoder_init(&decoder_, nullptr, 0);
+    }
+
+    std::vector<std::uint8_t> sysex_;
+    MidiDecoder decoder_;
+};
+
+class ChannelState {
+public:
+    ChannelState()
+        : state_(std::make_unique<MidiChannelState>()) {
+        midi_state_reset(state_.get());
+    }
+
+    void apply(std::span<const MidiMessage> messages) {
+        midi_state_apply_batch(state_.get(), messages.data(), messages.size());
+    }
+
+    bool note_is_on(std::uint8_t channel, std::uint8_t note) const {
+        return midi_state_note_is_on(state_.get(), channel, note);
+    }
+
+    std::uint8_t notes_held(std::uint8_t channel) const {
+        return midi_state_notes_held(state_.get(), channel);
+    }
+
+    void reset() {
+        midi_state_reset(state_.get());
+    }
+
+    const MidiChannelState& get() const {
+        return *state_;
+    }
+
+private:
+    std::unique_ptr<MidiChannelState> state_; // ~4.4 KB, kept off the stack
+};
+
+} // namespace mitzi
@@ -0,0 +1,260 @@
+// Multi-consumer simulation of the MIDI service ring (midi_bus.h).
+//
+//   bus_sim [records] [paced_rate]
+//
+// One producer thread publishes batches like the USB receive path, four
+// consumer threads read them in place:
+//   all-a, all-b  - every record, as fast as possible (fairness pair)
+//   notes         - Note On/Off only
+//   slow          - every record, but sleeps 5 ms after each run (a consumer
+//                   stuck in SD or display work)
+// Three runs:
+//   step  - one thread, fixed interleaving: the slow consumer reads only
+//           every two ring lengths. It must overflow, the others must get
+//           every record (isolation of the per-consumer cursors).
+//   paced - threads, producer at paced_rate records/s (default 250,000,
+//           about 80 times a saturated USB MIDI stream)
+//   flood - threads, unthrottled producer
+// Every record carries its sequence number, so consumers verify order and
+// integrity; per consumer, delivered + overflow must equal what was published.
+// Losses in the threaded runs depend on the scheduler and are only reported.
+// Output: one line per consumer and run, throughput and the fairness of the
+// two identical consumers. Exit status 1 on any violation.
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "midi_bus.h"
+
+#define RING 256    // Same as MIDI_SERVICE_RING on the device
+#define BATCH 16    // Same as MIDI_RX_BATCH
+#define CONSUMERS 4
+
+typedef struct {
+    const char* name;
+    uint8_t mask;
+    unsigned pause_us; // Simulated blocking work after each run
+    bool may_lose;    // Allowed to overflow in the paced run
+} ConsumerSpec;
+
+static const ConsumerSpec specs[CONSUMERS] = {
+    {"all-a", MIDI_BUS_ALL, 0, false},
+    {"all-b", MIDI_BUS_ALL, 0, false},
+    {"notes", MIDI_BUS_TYPE_BIT(MidiNoteOn) | MIDI_BUS_TYPE_BIT(MidiNoteOff), 0, false},
+    {"slow", MIDI_BUS_ALL, 5000, true},
+};
+
+typedef struct {
+    MidiBus* bus;
+    const ConsumerSpec* spec;
+    int id;
+    volatile bool* done;
+    uint32_t published; // Valid once done is set
+    uint64_t matched;   // Records of the wanted types, released intact
+    uint64_t expected_matched;
+    uint32_t errors;    // Sequence or content mismatches in intact runs
+    double seconds;
+} Consumer;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Record contents follow from the sequence number
+static void make_record(uint32_t seq, MidiMessage* m) {
+    static const uint8_t types[] = {0x90, 0x80, 0xB0, 0xE0, 0xC0, 0xF8};
+    memset(m, 0, sizeof(MidiMessage));
+    m->status = types[seq % 6] | (types[seq % 6] < 0xF0 ? (seq >> 3) & 0x0F : 0);
+    midi_parse_status(m->status, &m->type, &m->channel);
+    m->data1 = seq & 0x7F;
+    m->data2 = (seq >> 7) & 0x7F;
+    m->timestamp = seq;
+}
+
+// One peek/verify/release round, returns the records taken
+static size_t consumer_drain(Consumer* c) {
+    const MidiMessage* records;
+    size_t count = midi_bus_peek(c->bus, c->id, &records);
+    if(count == 0) return 0;
+    // After a lap peek moved the cursor: the run starts there
+    uint32_t first = c->bus->consumers[c->id].cursor;
+
+    uint64_t matched = 0;
+    uint32_t errors = 0;
+    for(size_t i = 0; i < count; i++) {
+        const MidiMessage* m = &records[i];
+        MidiMessage expected;
+        make_record(first + i, &expected);
+        if(m->timestamp != first + i || m->status != expected.status || m->data1 != expected.data1) {
+            errors++;
+        }
+        if(midi_bus_wants(c->bus, c->id, m)) matched++;
+    }
+    // Torn runs are overflow; only intact runs count
+    if(midi_bus_release(c->bus, c->id, count)) {
+        c->matched += matched;
+        c->errors += errors;
+    }
+    return count;
+}
+
+static void* consumer_thread(void* context) {
+    Consumer* c = context;
+    double start = now();
+
+    for(;;) {
+        bool finished = *(volatile bool*)c->done;
+        if(consumer_drain(c) == 0) {
+            if(finished) break;
+            // The device consumer waits for MIDI_SERVICE_FLAG_DATA instead
+            struct timespec pause = {.tv_nsec = 20000};
+            nanosleep(&pause, NULL);
+            continue;
+        }
+        if(c->spec->pause_us) {
+            struct timespec pause = {.tv_nsec = c->spec->pause_us * 1000L};
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    c->seconds = now() - start;
+    return NULL;
+}
+
+typedef enum {
+    RunStepped, // Single thread, fixed interleaving: losses only where intended
+    RunPaced,   // Threads, producer at a fixed rate
+    RunFlood,   // Threads, producer as fast as it can
+} RunMode;
+
+static const char* const run_names[] = {"step", "paced", "flood"};
+
+static int run(RunMode mode, uint32_t total, double rate) {
+    static MidiMessage ring[RING];
+    MidiBus bus;
+    midi_bus_init(&bus, ring, RING);
+    const char* name = run_names[mode];
+
+    volatile bool done = false;
+    Consumer consumers[CONSUMERS];
+    pthread_t threads[CONSUMERS];
+    for(int i = 0; i < CONSUMERS; i++) {
+        memset(&consumers[i], 0, sizeof(Consumer));
+        consumers[i].bus = &bus;
+        consumers[i].spec = &specs[i];
+        consumers[i].id = midi_bus_subscribe(&bus, specs[i].mask);
+        consumers[i].done = &done;
+    }
+    if(mode != RunStepped) {
+        for(int i = 0; i < CONSUMERS; i++) {
+            pthread_create(&threads[i], NULL, consumer_thread, &consumers[i]);
+        }
+    }
+
+    MidiMessage batch[BATCH];
+    uint64_t wanted[CONSUMERS] = {0};
+    uint32_t published = 0;
+    double start = now();
+    for(uint32_t seq = 0; seq < total; seq += BATCH) {
+        for(uint32_t i = 0; i < BATCH; i++) {
+            make_record(seq + i, &batch[i]);
+            for(int c = 0; c < CONSUMERS; c++) {
+                if(specs[c].mask & MIDI_BUS_TYPE_BIT(batch[i].status)) wanted[c]++;
+            }
+        }
+        if(mode == RunPaced) {
+            // Sleep like a USB producer between transfers (works on a single core too)
+            double due = start + (seq + BATCH) / rate;
+            struct timespec ts = {.tv_sec = (time_t)due, .tv_nsec = (long)((due - (time_t)due) * 1e9)};
+            if(now() < due) {
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+            } else {
+                sched_yield(); // Catching up: still one transfer at a time
+            }
+        }
+        midi_bus_publish(&bus, batch, BATCH);
+        published += BATCH;
+
+        if(mode == RunStepped) {
+            // Slow consumers get a turn every 2 ring lengths, the others after every batch
+            uint32_t batches = published / BATCH;
+            for(int i = 0; i < CONSUMERS; i++) {
+                if(specs[i].pause_us && batches % (2 * RING / BATCH) != 0) continue;
+                while(consumer_drain(&consumers[i]) > 0) {
+                }
+            }
+        }
+    }
+    if(mode == RunStepped) {
+        for(int i = 0; i < CONSUMERS; i++) {
+            while(consumer_drain(&consumers[i]) > 0) {
+            }
+        }
+    }
+    double produce = now() - start;
+    done = true;
+
+    int status = 0;
+    for(int i = 0; i < CONSUMERS; i++) {
+        Consumer* c = &consumers[i];
+        if(mode != RunStepped) {
+            pthread_join(threads[i], NULL);
+        } else {
+            c->seconds = produce;
+        }
+        const MidiBusConsumer* state = &bus.consumers[c->id];
+        bool accounted = (uint64_t)state->delivered + state->overflow == published;
+        bool lossless = state->overflow == 0 && c->matched == wanted[i];
+        bool lost_as_intended = specs[i].pause_us ? state->overflow > 0 : lossless;
+        // Threaded runs depend on the scheduler: losses are reported, not judged
+        bool ok = accounted && c->errors == 0 && (mode != RunStepped || lost_as_intended);
+        printf(
+            "%-6s %-8s %10u %10u %10llu %7.2f%% %12.0f %s\n",
+            name,
+            c->spec->name,
+            state->delivered,
+            state->overflow,
+            (unsigned long long)c->matched,
+            100.0 * state->delivered / published,
+            state->delivered / c->seconds,
+            ok ? "ok" : "FAIL");
+        if(!ok) status = 1;
+    }
+
+    // Fairness: the two identical consumers should see the same share
+    double a = bus.consumers[consumers[0].id].delivered;
+    double b = bus.consumers[consumers[1].id].delivered;
+    printf(
+        "%-6s producer %.0f records/s, fairness all-a/all-b %.3f\n",
+        name,
+        published / produce,
+        a > b ? b / a : (b > 0 ? a / b : 1.0));
+    return status;
+}
+
+int main(int argc, char** argv) {
+    uint32_t total = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 2000000;
+    double rate = argc > 2 ? strtod(argv[2], NULL) : 250000;
+
+    printf(
+        "%-6s %-8s %10s %10s %10s %8s %12s\n",
+        "run",
+        "consumer",
+        "delivered",
+        "overflow",
+        "matched",
+        "share",
+        "records/s");
+    int status = run(RunStepped, total, 0);
+    status |= run(RunPaced, total, rate);
+    status |= run(RunFlood, total * 10, 0);
+    return status;
+}
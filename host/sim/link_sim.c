@@ -0,0 +1,149 @@
+// DIN link test on a simulated noisy channel: the same midi_link_test code
+// the device runs in its RX DMA callback, fed by a model of a 31.25 kbaud
+// 8N1 UART with random bit errors and dropped bytes.
+//
+//   link_sim [bytes] [drop_rate] [seed]
+//
+// Runs a sweep of bit error rates. Per bit of a frame: a flipped start bit
+// loses the byte, a flipped data bit corrupts it, a flipped stop bit is a
+// framing error (the byte is still delivered, like on the STM32). Bytes
+// arrive in DMA batches (half transfer or line idle) with interrupt jitter.
+// Output: one line per run, injected vs. measured.
+// Exit status is 1 if the checker's count is off by more than 1%.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "midi_link_test.h"
+
+#define BYTE_US 320     // 10 bits at 31250 baud
+#define CHUNK 32        // Same as MIDI_DIN_LINK_CHUNK on the device
+#define DMA_BATCH 16    // Half of a 32-byte DMA buffer
+
+static uint64_t rng_state;
+
+static double rng_uniform(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (rng_state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+typedef struct {
+    uint32_t corrupted;
+    uint32_t dropped;
+    uint32_t framing;
+} Injected;
+
+static void deliver(MidiLinkTest* test, const uint8_t* data, size_t length, uint32_t now) {
+    if(length == 0) return;
+    uint32_t irq_us = 5 + (uint32_t)(rng_uniform() * 45); // ISR entry + DMA read
+    midi_link_test_rx(test, data, length, now + irq_us);
+}
+
+static int run(uint32_t bytes, double bit_error_rate, double drop_rate) {
+    MidiLinkTest test;
+    midi_link_test_init(&test, 0xACE1, 1);
+    Injected injected = {0};
+
+    uint8_t chunk[CHUNK];
+    uint8_t rx[DMA_BATCH];
+    size_t rx_length = 0;
+    uint32_t now = 0;
+
+    for(uint32_t sent = 0; sent < bytes; sent += CHUNK) {
+        midi_link_test_tx(&test, chunk, CHUNK, now);
+
+        for(size_t i = 0; i < CHUNK; i++) {
+            now += BYTE_US;
+            uint8_t byte = chunk[i];
+            bool lost = false;
+            bool framing = false;
+            for(uint8_t bit = 0; bit < 10; bit++) {
+                if(rng_uniform() >= bit_error_rate) continue;
+                if(bit == 0) {
+                    lost = true;
+                } else if(bit == 9) {
+                    framing = true;
+                } else {
+                    byte ^= 1 << (bit - 1);
+                }
+            }
+            if(!lost && rng_uniform() < drop_rate) {
+                lost = true;
+                midi_link_test_error(&test, MidiLinkErrorOverrun);
+            }
+
+            if(lost) {
+                injected.dropped++;
+                continue;
+            }
+            if(byte != chunk[i]) injected.corrupted++;
+            if(framing) {
+                injected.framing++;
+                midi_link_test_error(&test, MidiLinkErrorFraming);
+            }
+
+            rx[rx_length++] = byte;
+            if(rx_length == DMA_BATCH) {
+                deliver(&test, rx, rx_length, now);
+                rx_length = 0;
+            }
+        }
+        // TX waits for completion before the next chunk: the line goes idle
+        now += BYTE_US;
+        deliver(&test, rx, rx_length, now);
+        rx_length = 0;
+    }
+
+    uint32_t expected = injected.corrupted + injected.dropped;
+    uint32_t measured = test.errors + test.lost;
+    uint32_t diff = expected > measured ? expected - measured : measured - expected;
+    bool ok = diff <= expected / 100 + 2 && test.framing_errors == injected.framing;
+
+    printf(
+        "%-8.0e %9" PRIu32 " %9" PRIu32 " %9" PRIu32 " %9" PRIu32 " %9" PRIu32 " %9" PRIu32
+        " %7" PRIu32 " %6" PRIu32 " %5" PRIu32 "/%" PRIu32 "/%" PRIu32 " %s\n",
+        bit_error_rate,
+        test.sent,
+        injected.corrupted,
+        test.errors,
+        injected.dropped,
+        test.lost,
+        injected.framing,
+        midi_link_test_error_ppm(&test),
+        test.resyncs,
+        test.latency_count ? test.latency_min_us : 0,
+        midi_link_test_latency_avg_us(&test),
+        test.latency_max_us,
+        ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    uint32_t bytes = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 1000000;
+    double drop_rate = argc > 2 ? strtod(argv[2], NULL) : 1e-5;
+    rng_state = argc > 3 ? strtoull(argv[3], NULL, 0) : 0x9E3779B97F4A7C15ULL;
+    if(rng_state == 0) rng_state = 1;
+
+    static const double bit_error_rates[] = {0, 1e-6, 1e-5, 1e-4, 1e-3};
+
+    printf(
+        "%-8s %9s %9s %9s %9s %9s %9s %7s %6s %s\n",
+        "ber",
+        "sent",
+        "corrupt",
+        "errors",
+        "dropped",
+        "lost",
+        "framing",
+        "ppm",
+        "resync",
+        "latency us");
+    int status = 0;
+    for(size_t i = 0; i < sizeof(bit_error_rates) / sizeof(bit_error_rates[0]); i++) {
+        status |= run(bytes, bit_error_rates[i], drop_rate);
+    }
+    return status;
+}
@@ -0,0 +1,204 @@
+// Playout buffer on simulated clumpy transports: the same midi_playout code
+// the DIN thru uses, fed by models of a steady link, a USB link that stalls
+// now and then, and BLE connection events.
+//
+//   playout_sim [messages] [percentile] [seed]
+//
+// A busy player (fast runs, controller sweeps) sends a message every 1 to
+// 5 ms. The transport delivers them in
+// transfers; the steady and USB models carry no sender timestamps (source
+// times are estimated with midi_playout_source()), BLE carries them. The
+// scheduler sends due messages with 20 us resolution.
+//
+// Output: one line per transport with the spacing error of consecutive
+// messages (|delivered gap - source gap|) on arrival and after the playout
+// buffer, the added latency and the residual jitter the buffer reports.
+// Exit status is 1 if the buffer does not cut the p95 spacing error on the
+// clumpy transports (to a half for USB, a quarter for BLE) or adds more than
+// 3 ms on the steady one. A stall that delivers a single message cannot be
+// told from the player's own timing without sender timestamps; that is what
+// remains on USB.
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "midi_playout.h"
+
+#define MAX_MESSAGES 16384 // Message index is sent in two 7-bit data bytes
+#define TRANSFER_MAX 16    // Messages per USB transfer (MIDI_RX_BATCH)
+#define STEP_US 20         // Scheduler resolution
+#define MAX_LATENCY_US 30000
+
+typedef enum {
+    TransportSteady, // One message per transfer, 0.3-1 ms transit
+    TransportUsb,    // 1 ms polling, stalls of 8-25 ms (5 % per poll)
+    TransportBle,    // 15 ms connection events with 0-1 ms jitter, sender timestamps
+} Transport;
+
+static const char* const transport_names[] = {"steady", "usb", "ble"};
+
+static uint64_t rng_state;
+
+static double rng_uniform(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (rng_state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint32_t rng_range(uint32_t low, uint32_t high) {
+    return low + (uint32_t)(rng_uniform() * (high - low + 1));
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// p95 and max of |gap(times) - gap(sources)| over consecutive messages
+static void spacing_error(
+    const uint32_t* times,
+    const uint32_t* sources,
+    size_t count,
+    uint32_t* scratch,
+    uint32_t* p95,
+    uint32_t* max) {
+    for(size_t i = 1; i < count; i++) {
+        int64_t error = ((int64_t)times[i] - times[i - 1]) - ((int64_t)sources[i] - sources[i - 1]);
+        scratch[i - 1] = (uint32_t)(error < 0 ? -error : error);
+    }
+    qsort(scratch, count - 1, sizeof(uint32_t), compare_u32);
+    *p95 = scratch[(count - 1) * 95 / 100];
+    *max = scratch[count - 2];
+}
+
+static int run(Transport transport, size_t count, uint8_t percentile) {
+    static uint32_t sources[MAX_MESSAGES];
+    static uint32_t arrivals[MAX_MESSAGES];
+    static uint32_t emits[MAX_MESSAGES];
+    static uint32_t scratch[MAX_MESSAGES];
+    static MidiPlayout playout;
+
+    uint32_t time = 1000;
+    for(size_t i = 0; i < count; i++) {
+        sources[i] = time;
+        time += rng_range(1000, 5000);
+    }
+
+    // Transfers: arrivals[i] is when message i reached the receive path
+    size_t next = 0;
+    uint32_t poll = 0;
+    while(next < count) {
+        switch(transport) {
+        case TransportSteady:
+            arrivals[next] = sources[next] + rng_range(300, 1000);
+            next++;
+            continue;
+        case TransportUsb:
+            poll += 1000;
+            if(rng_uniform() < 0.05) poll += rng_range(8000, 25000);
+            break;
+        case TransportBle:
+            poll += 15000;
+            break;
+        }
+        uint32_t arrival = poll + (transport == TransportBle ? rng_range(0, 1000) : 0);
+        for(size_t n = 0; n < TRANSFER_MAX && next < count && sources[next] <= poll; n++) {
+            arrivals[next++] = arrival;
+        }
+    }
+
+    midi_playout_init(&playout, 1, percentile, MAX_LATENCY_US);
+    size_t pushed = 0;
+    size_t emitted = 0;
+    uint32_t now = 0;
+    while(emitted < count) {
+        // Hand over every transfer that has arrived
+        while(pushed < count && arrivals[pushed] <= now) {
+            size_t first = pushed;
+            while(pushed < count && arrivals[pushed] == arrivals[first]) pushed++;
+            size_t transfer = pushed - first;
+            for(size_t i = first; i < pushed; i++) {
+                uint32_t source = transport == TransportBle ?
+                                      sources[i] :
+                                      midi_playout_source(&playout, arrivals[i], i - first, transfer);
+                uint8_t message[3] = {0x90, i & 0x7F, (i >> 7) & 0x7F};
+                midi_playout_push(&playout, message, sizeof(message), arrivals[i], source);
+            }
+            midi_playout_transfer(&playout, arrivals[first]);
+        }
+
+        uint8_t out[MIDI_PLAYOUT_SIZE * MIDI_PLAYOUT_MAX_BYTES];
+        size_t length = midi_playout_pop(&playout, now, out, sizeof(out));
+        for(size_t i = 0; i + 2 < length; i += 3) {
+            emits[out[i + 1] | out[i + 2] << 7] = now;
+            emitted++;
+        }
+        now += STEP_US;
+    }
+
+    uint32_t in_p95, in_max, out_p95, out_max;
+    spacing_error(arrivals, sources, count, scratch, &in_p95, &in_max);
+    spacing_error(emits, sources, count, scratch, &out_p95, &out_max);
+
+    bool ok = playout.overflow == 0;
+    switch(transport) {
+    case TransportSteady:
+        ok = ok && midi_latency_avg(&playout.added_us) < 3000 && out_p95 <= in_p95 + STEP_US;
+        break;
+    case TransportUsb:
+        ok = ok && out_p95 < in_p95 / 2;
+        break;
+    case TransportBle:
+        ok = ok && out_p95 < in_p95 / 4;
+        break;
+    }
+
+    printf(
+        "%-7s %6zu %7" PRIu32 " %7" PRIu32 " %7" PRIu32 " %7" PRIu32 " %7" PRIu32 " %6" PRIu32
+        "/%" PRIu32 " %6" PRIu32 "/%" PRIu32 " %5" PRIu32 " %s\n",
+        transport_names[transport],
+        count,
+        in_p95,
+        in_max,
+        out_p95,
+        out_max,
+        midi_playout_target_us(&playout),
+        midi_latency_avg(&playout.added_us),
+        playout.added_us.max,
+        midi_latency_avg(&playout.residual_us),
+        playout.residual_us.max,
+        playout.late,
+        ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 0) : 10000;
+    uint8_t percentile = argc > 2 ? (uint8_t)strtoul(argv[2], NULL, 0) : 95;
+    rng_state = argc > 3 ? strtoull(argv[3], NULL, 0) : 0x9E3779B97F4A7C15ULL;
+    if(rng_state == 0) rng_state = 1;
+    if(count < 2) count = 2;
+    if(count > MAX_MESSAGES) count = MAX_MESSAGES;
+
+    printf(
+        "%-7s %6s %7s %7s %7s %7s %7s %13s %13s %5s\n",
+        "link",
+        "msgs",
+        "in p95",
+        "in max",
+        "out p95",
+        "out max",
+        "target",
+        "added avg/max",
+        "resid avg/max",
+        "late");
+    int status = 0;
+    for(Transport transport = TransportSteady; transport <= TransportBle; transport++) {
+        status |= run(transport, count, percentile);
+    }
+    return status;
+}
@@ -1,87 +1,12 @@
-#include <furi.h> // Flipper Universal Registry Implementation = Core OS functionality
-#include <furi_hal.h> // Hardware abstraction layer
-#include <gui/gui.h> // GUI system
-#include <input/input.h> // Input handling (buttons)
+#include "midi_app.h" // Application state, events and views
 #include <gui/elements.h> // Button drawing functions
 #include "midi_icons.h" // Custom icon definitions
-
-#define TAG "Mitzi_Midi"
-#define MAX_MIDI_MESSAGES 3 // Number of MIDI messages to display in history
-
-// MIDI message types (status bytes)
-typedef enum {
-    MidiNoteOff = 0x80,          // Note Off
-    MidiNoteOn = 0x90,           // Note On
-    MidiPolyAftertouch = 0xA0,   // Polyphonic Key Pressure
-    MidiControlChange = 0xB0,     // Control Change
-    MidiProgramChange = 0xC0,     // Program Change
-    MidiChannelAftertouch = 0xD0, // Channel Pressure
-    MidiPitchBend = 0xE0,         // Pitch Bend
-    MidiSystemMessage = 0xF0      // System messages
-} MidiMessageType;
-
-// Structure to store a parsed MIDI message
-typedef struct {
-    uint8_t status;      // Status byte (includes channel)
-    uint8_t data1;       // First data byte
-    uint8_t data2;       // Second data byte (if applicable)
-    uint8_t channel;     // MIDI channel (0-15)
-    MidiMessageType type; // Message type
-    uint32_t timestamp;  // Time received (in ticks)
-} MidiMessage;
-
-// Application state
-typedef struct {
-    MidiMessage messages[MAX_MIDI_MESSAGES]; // Ring buffer of received messages
-    uint8_t message_count;                   // Total messages received
-    bool usb_connected;                      // USB connection status
-    uint32_t last_message_time;              // Timestamp of last message
-    uint32_t blink_counter;                  // Counter for USB icon blinking
-} MidiState;
-
-// Event types for the application
-typedef enum {
-    EventTypeKey,        // User input event
-    EventTypeMidi,       // MIDI data received
-    EventTypeUsbStatus   // USB connection status change
-} EventType;
-
-// Application event structure
-typedef struct {
-    EventType type;
-    union {
-        InputEvent input;      // For keyboard events
-        MidiMessage midi;      // For MIDI events
-        bool usb_connected;    // For USB status events
-    };
-} MidiEvent;
-
-// Main application context
-typedef struct {
-    MidiState* state;
-    FuriMutex* mutex;
-    FuriMessageQueue* event_queue;
-    ViewPort* view_port;
-} MidiApp;
-
-// Parse MIDI status byte to extract message type and channel
-// Currently commented out as it's only used by usb_midi_rx_callback (also commented out)
-/*
-static void parse_midi_status(uint8_t status, MidiMessageType* type, uint8_t* channel) {
-    if(status < 0xF0) {
-        // Channel messages (0x80-0xEF)
-        *type = status & 0xF0;  // Upper nibble = message type
-        *channel = status & 0x0F; // Lower nibble = channel (0-15)
-    } else {
-        // System messages (0xF0-0xFF)
-        *type = MidiSystemMessage;
-        *channel = 0; // System messages don't have channels
-    }
-}
-*/
+#if MIDI_FEATURE_RECORDER
+#include <storage/storage.h> // Trace file
+#endif
 
 // Add a MIDI message to the ring buffer
-static void add_midi_message(MidiState* state, const MidiMessage* message) {
+static void add_midi_message(MidiState* state, const MidiHistoryEntry* entry) {
     // Shift existing messages down
     if(state->message_count < MAX_MIDI_MESSAGES) {
         state->message_count++;
@@ -93,85 +18,72 @@ static void add_midi_message(MidiState* state, const MidiMessage* message) {
     }
     
     // Add new message at the top
-    state->messages[0] = *message;
+    state->messages[0] = *entry;
     state->last_message_time = furi_get_tick();
 }
 
-// Convert MIDI note number to string representation (e.g., C4, A#5)
-static void midi_note_to_string(uint8_t note, char* buffer, size_t size) {
-    const char* note_names[] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
-    uint8_t octave = (note / 12) - 1;
-    uint8_t note_index = note % 12;
-    snprintf(buffer, size, "%s%d", note_names[note_index], octave);
-}
-
-// Format MIDI message for display
-static void format_midi_message(const MidiMessage* msg, char* buffer, size_t size) {
-    char note_str[8];
-    
-    switch(msg->type) {
-    case MidiNoteOn:
-        if(msg->data2 > 0) {
-            midi_note_to_string(msg->data1, note_str, sizeof(note_str));
-            snprintf(buffer, size, "NoteOn  Ch%02d %s Vel%03d", 
-                    msg->channel + 1, note_str, msg->data2);
-        } else {
-            // Note On with velocity 0 is treated as Note Off
-            midi_note_to_string(msg->data1, note_str, sizeof(note_str));
-            snprintf(buffer, size, "NoteOff Ch%02d %s", 
-                    msg->channel + 1, note_str);
-        }
-        break;
-        
-    case MidiNoteOff:
-        midi_note_to_string(msg->data1, note_str, sizeof(note_str));
-        snprintf(buffer, size, "NoteOff Ch%02d %s Vel%03d", 
-                msg->channel + 1, note_str, msg->data2);
-        break;
-        
-    case MidiControlChange:
-        snprintf(buffer, size, "CC      Ch%02d #%03d=%03d", 
-                msg->channel + 1, msg->data1, msg->data2);
+// Format one history line
+static void format_history_entry(const MidiHistoryEntry* entry, char* buffer, size_t size) {
+    switch(entry->kind) {
+    case MidiHistoryParam:
+        midi_param_format(
+            entry->param.manufacturer,
+            entry->param.address,
+            entry->param.address_size,
+            entry->param.value,
+            buffer,
+            size);
         break;
-        
-    case MidiProgramChange:
-        snprintf(buffer, size, "ProgChg Ch%02d Prg%03d", 
-                msg->channel + 1, msg->data1);
-        break;
-        
-    case MidiPitchBend:
-        {
-            int16_t bend = ((msg->data2 << 7) | msg->data1) - 8192;
-            snprintf(buffer, size, "PitchBd Ch%02d %+05d", 
-                    msg->channel + 1, bend);
-        }
-        break;
-        
-    case MidiChannelAftertouch:
-        snprintf(buffer, size, "ChPress Ch%02d Val%03d", 
-                msg->channel + 1, msg->data1);
-        break;
-        
-    case MidiPolyAftertouch:
-        midi_note_to_string(msg->data1, note_str, sizeof(note_str));
-        snprintf(buffer, size, "PolyAT  Ch%02d %s P%03d", 
-                msg->channel + 1, note_str, msg->data2);
-        break;
-        
-    case MidiSystemMessage:
-        snprintf(buffer, size, "System  0x%02X", msg->status);
+    case MidiHistoryUniversal:
+        midi_universal_format(&entry->universal, buffer, size);
         break;
-        
     default:
-        snprintf(buffer, size, "Unknown 0x%02X", msg->status);
+        midi_format_message(&entry->message, buffer, size);
         break;
     }
 }
 
+// Draw MIDI message history
+static void draw_history(Canvas* canvas, const MidiState* state) {
+    canvas_set_font(canvas, FontKeyboard);
+    uint8_t y = 22;
+    char msg_buffer[32];
+    
+    uint8_t messages_to_show = (state->message_count < MAX_MIDI_MESSAGES) ? 
+                               state->message_count : MAX_MIDI_MESSAGES;
+    
+    for(uint8_t i = 0; i < messages_to_show; i++) {
+        format_history_entry(&state->messages[i], msg_buffer, sizeof(msg_buffer));
+        canvas_draw_str(canvas, 1, y, msg_buffer);
+        y += 9;
+    }
+    
+    // If no messages yet, show helpful text
+    if(state->message_count == 0) {
+        canvas_set_font(canvas, FontSecondary);
+        canvas_draw_str_aligned(canvas, 64, 30, AlignCenter, AlignTop, "Waiting for MIDI...");
+    }
+}
+
 // Render callback for GUI - draws the interface
 static void render_callback(Canvas* canvas, void* ctx) {
     MidiApp* app = ctx;
+    
+#if MIDI_FEATURE_VIEWS
+    if(app->state->view == MidiViewMonitor) {
+        // No app mutex here: the monitor never waits for the main loop
+        MIDI_RENDER_STAGE(app, MidiRenderDraw);
+        canvas_clear(canvas);
+        midi_view_monitor_draw(canvas, app);
+        MIDI_RENDER_STAGE(app, MidiRenderIdle);
+        return;
+    }
+#endif
+    
+    MIDI_RENDER_STAGE(app, MidiRenderLock);
     furi_mutex_acquire(app->mutex, FuriWaitForever);
+    MIDI_RENDER_STAGE(app, MidiRenderDraw);
+    MIDI_TRACE(app, MidiTraceBegin, MidiTraceRenderLock, app->state->view);
     
     canvas_clear(canvas);
     
@@ -181,6 +93,12 @@ static void render_callback(Canvas* canvas, void* ctx) {
     canvas_draw_str_aligned(canvas, 12, 1, AlignLeft, AlignTop, "Mitzi Midi");
     canvas_set_font(canvas, FontSecondary);
     
+#if MIDI_FEATURE_RECORDER
+    if(midi_recorder_is_active(app->recorder)) {
+        canvas_draw_str_aligned(canvas, 115, 1, AlignRight, AlignTop, "REC");
+    }
+#endif
+    
     // USB symbol (blinks fast when searching, blinks slow when connected)
     // Fast blink when waiting (every ~0.3 seconds), slow when connected (every ~1 second)
     uint32_t blink_divisor = app->state->usb_connected ? 10 : 3;
@@ -193,33 +111,56 @@ static void render_callback(Canvas* canvas, void* ctx) {
     canvas_draw_str(canvas, 128, 47, "f418.eu");        
     canvas_set_font_direction(canvas, CanvasDirectionLeftToRight);
     
-    // Draw MIDI message history
-    canvas_set_font(canvas, FontKeyboard);
-    uint8_t y = 22;
-    char msg_buffer[32];
-    
-    uint8_t messages_to_show = (app->state->message_count < MAX_MIDI_MESSAGES) ? 
-                               app->state->message_count : MAX_MIDI_MESSAGES;
-    
-    for(uint8_t i = 0; i < messages_to_show; i++) {
-        format_midi_message(&app->state->messages[i], msg_buffer, sizeof(msg_buffer));
-        canvas_draw_str(canvas, 1, y, msg_buffer);
-        y += 9;
-    }
-    
-    // If no messages yet, show helpful text
-    if(app->state->message_count == 0) {
-        canvas_set_font(canvas, FontSecondary);
-        canvas_draw_str_aligned(canvas, 64, 30, AlignCenter, AlignTop, "Waiting for MIDI...");
+    switch(app->state->view) {
+#if MIDI_FEATURE_VIEWS && MIDI_FEATURE_ANALYZERS
+    case MidiViewParams:
+        midi_view_params_draw(canvas, app);
+        break;
+    case MidiViewMeters:
+        midi_view_meters_draw(canvas, app);
+        break;
+    case MidiViewJitter:
+        midi_view_jitter_draw(canvas, app);
+        break;
+#endif
+#if MIDI_FEATURE_VIEWS && MIDI_FEATURE_DIAGNOSTICS
+    case MidiViewDiagnostics:
+        midi_view_diagnostics_draw(canvas, app);
+        break;
+#endif
+#if MIDI_FEATURE_VIEWS && MIDI_FEATURE_OUTPUT
+    case MidiViewVelocity:
+        midi_view_velocity_draw(canvas, app);
+        break;
+    case MidiViewPlayout:
+        midi_view_playout_draw(canvas, app);
+        break;
+    case MidiViewLinkTest:
+        midi_view_link_test_draw(canvas, app);
+        break;
+#endif
+    default:
+        draw_history(canvas, app->state);
+#if MIDI_FEATURE_VIEWS
+        if(app->state->draw_pending) {
+            midi_latency_add(
+                &app->latency_history, midi_cycles_to_us(midi_cycles() - app->state->draw_arrival));
+            app->state->draw_pending = false;
+        }
+#endif
+        break;
     }
     
     // Navigation hint
+    canvas_set_font(canvas, FontSecondary);
     canvas_draw_icon(canvas, 1, 55, &I_arrows);
     canvas_draw_str_aligned(canvas, 11, 63, AlignLeft, AlignBottom, "Choose");
     canvas_draw_icon(canvas, 121, 57, &I_back);
     canvas_draw_str_aligned(canvas, 120, 63, AlignRight, AlignBottom, "Pause");
     
+    MIDI_TRACE(app, MidiTraceEnd, MidiTraceRenderLock, 0);
     furi_mutex_release(app->mutex);
+    MIDI_RENDER_STAGE(app, MidiRenderIdle);
 }
 
 // Input callback - queues input events for processing
@@ -229,43 +170,271 @@ static void input_callback(InputEvent* input_event, void* ctx) {
     furi_message_queue_put(app->event_queue, &event, FuriWaitForever);
 }
 
-// USB MIDI receive callback (placeholder - needs USB HAL integration)
-// This would be called by USB interrupt handler when MIDI data arrives
-// Currently commented out to avoid unused function warning until USB HAL is integrated
-/*
-static void usb_midi_rx_callback(uint8_t* data, size_t length, void* ctx) {
-    MidiApp* app = ctx;
-    
+// USB MIDI receive path (placeholder - needs USB HAL integration)
+// This would be called by the USB MIDI class when MIDI data arrives
+void midi_usb_rx(MidiApp* app, const uint8_t* data, size_t length) {
     // USB MIDI packets are 4 bytes: [Cable/CIN][Status][Data1][Data2]
-    // CIN = Code Index Number (upper nibble of byte 0)
-    // Cable = Virtual cable number (lower nibble of byte 0)
-    
-    for(size_t i = 0; i + 3 < length; i += 4) {
-        uint8_t cin = (data[i] >> 4) & 0x0F;
-        uint8_t status = data[i + 1];
-        uint8_t data1 = data[i + 2];
-        uint8_t data2 = data[i + 3];
-        
-        // Skip if no valid MIDI message (CIN == 0)
-        if(cin == 0) continue;
+    // CIN = Code Index Number (lower nibble of byte 0)
+    // Cable = Virtual cable number (upper nibble of byte 0)
+    // The whole transfer is decoded in one batch into a stack array, then queued.
+    
+    MidiMessage batch[MIDI_RX_BATCH];
+    uint32_t arrival = midi_cycles();
+    uint32_t now = furi_get_tick();
+#if MIDI_FEATURE_OUTPUT
+    bool playout = app->din && midi_din_playout_begin(app->din);
+    size_t packets = length / MIDI_USB_PACKET_SIZE;
+    size_t position = 0; // Message index within the transfer
+#endif
+    
+#if MIDI_FEATURE_RECORDER
+    midi_trace_add(&app->trace, arrival, MidiTraceBegin, MidiTraceUsbRx, length);
+    // Raw packets go to the recorder untouched (SysEx included)
+    for(size_t i = 0; i + 3 < length; i += MIDI_USB_PACKET_SIZE) {
+        midi_recorder_push(app->recorder, now, &data[i]);
+    }
+#endif
+    
+    while(length >= MIDI_USB_PACKET_SIZE) {
+        size_t consumed = 0;
+        size_t count = midi_decode_packets(
+            &app->decoder, data, length, now, batch, MIDI_RX_BATCH, &consumed);
         
-        MidiMessage msg = {0};
-        msg.status = status;
-        msg.data1 = data1;
-        msg.data2 = data2;
-        msg.timestamp = furi_get_tick();
+        for(size_t i = 0; i < count; i++) {
+            MidiEvent event = {.type = EventTypeMidi, .arrival = arrival, .midi = batch[i]};
+#if MIDI_FEATURE_RECORDER
+            midi_trace_add(
+                &app->trace,
+                arrival,
+                MidiTraceInstant,
+                MidiTraceMidiIn,
+                batch[i].status | batch[i].data1 << 8 | batch[i].data2 << 16);
+#endif
+            
+            // A completed SysEx is always the last message of a batch (sysex_done;
+            // a lone F0 byte sent with CIN 0xF has the same status but no buffer).
+            // Short ones are copied out so the main loop can decode them,
+            // longer universal ones (MTS dumps) go through a single slot.
+            size_t sysex_length;
+            const uint8_t* sysex = midi_decoder_sysex(&app->decoder, &sysex_length);
+            bool sysex_long = false;
+            if(i + 1 == count && app->decoder.sysex_done && !app->decoder.sysex.overflow) {
+                if(sysex_length <= MIDI_SYSEX_EVENT_SIZE) {
+                    event.type = EventTypeSysex;
+                    event.sysex.timestamp = now;
+                    event.sysex.length = sysex_length;
+                    memcpy(event.sysex.data, sysex, sysex_length);
+                } else if(
+                    (sysex[1] == MIDI_UNIVERSAL_NON_REALTIME || sysex[1] == MIDI_UNIVERSAL_REALTIME) &&
+                    !__atomic_load_n(&app->sysex_long_busy, __ATOMIC_ACQUIRE)) {
+                    // Slot still in use: only the plain message reaches the history
+                    memcpy(app->sysex_long, sysex, sysex_length);
+                    app->sysex_long_length = sysex_length;
+                    __atomic_store_n(&app->sysex_long_busy, true, __ATOMIC_RELEASE);
+                    sysex_long = true;
+                    event.type = EventTypeSysex;
+                    event.sysex.timestamp = now;
+                    event.sysex.length = 0;
+                }
+            }
+            
+            // Queue the MIDI event
+            if(furi_message_queue_put(app->event_queue, &event, 0) != FuriStatusOk) {
+                if(sysex_long) __atomic_store_n(&app->sysex_long_busy, false, __ATOMIC_RELEASE);
+                MIDI_TRACE(app, MidiTraceInstant, MidiTraceQueueFull, event.type);
+#if MIDI_FEATURE_DIAGNOSTICS
+                app->queue_dropped++;
+#endif
+            }
+            
+#if MIDI_FEATURE_OUTPUT
+            // Thru to the DIN port, right here rather than after the queue
+            uint8_t bytes[MIDI_THRU_MAX_BYTES];
+            size_t byte_count;
+            if(app->din && (byte_count = midi_thru_process(&app->thru, &batch[i], bytes))) {
+                if(playout) {
+                    // No sender timestamps on USB: estimated from the clump
+                    uint32_t source = midi_playout_source(
+                        midi_din_playout(app->din), arrival, position, packets);
+                    midi_din_schedule(app->din, bytes, byte_count, arrival, source);
+                } else {
+                    midi_din_send(app->din, bytes, byte_count);
+                }
+            }
+            position++;
+#endif
+        }
         
-        parse_midi_status(status, &msg.type, &msg.channel);
+#if MIDI_FEATURE_SERVICE
+        midi_service_publish(app->service, batch, count);
+#endif
         
-        // Queue the MIDI event
-        MidiEvent event = {.type = EventTypeMidi, .midi = msg};
-        furi_message_queue_put(app->event_queue, &event, 0);
+#if MIDI_FEATURE_VIEWS
+        // The fast monitor draws straight from this slot, ahead of the queue.
+        // The redraw is requested here too; view_port_update() takes a mutex,
+        // so from an interrupt it is left to the main loop.
+        if(count > 0 && app->state->view == MidiViewMonitor) {
+            midi_monitor_publish(&app->monitor, &batch[count - 1], arrival);
+            if(furi_kernel_is_irq_or_masked()) {
+                __atomic_store_n(&app->monitor_redraw, true, __ATOMIC_RELEASE);
+            } else {
+                view_port_update(app->view_port);
+            }
+        }
+#endif
         
-        FURI_LOG_D(TAG, "MIDI: CIN=%X Status=%02X Data=%02X %02X", 
-                  cin, status, data1, data2);
+        data += consumed;
+        length -= consumed;
+    }
+    
+#if MIDI_FEATURE_OUTPUT
+    if(playout) {
+        midi_playout_transfer(midi_din_playout(app->din), arrival);
+        midi_din_playout_end(app->din);
+    }
+#endif
+    MIDI_TRACE(app, MidiTraceCounter, MidiTraceQueue, furi_message_queue_get_count(app->event_queue));
+    MIDI_TRACE(app, MidiTraceEnd, MidiTraceUsbRx, 0);
+}
+
+// Decode a SysEx: universal messages and parameter changes update the
+// tracked state and show up decoded in the history
+static void handle_sysex(MidiState* state, uint32_t timestamp, const uint8_t* data, size_t length) {
+    MidiHistoryEntry entry = {
+        .message = {
+            .status = MIDI_SYSEX_START,
+            .data1 = data[1],
+            .type = MidiSystemMessage,
+            .timestamp = timestamp,
+        },
+        .kind = MidiHistoryMessage,
+    };
+    
+    MidiParamChange change;
+    MidiParamStatus status;
+    if(midi_universal_decode(data, length, &entry.universal)) {
+        entry.kind = MidiHistoryUniversal;
+#if MIDI_FEATURE_ANALYZERS
+        midi_universal_apply(&state->universal, &entry.universal);
+#endif
+        MidiUniversalKind kind = entry.universal.kind;
+        if(kind == MidiUniversalGmOn || kind == MidiUniversalGm2On || kind == MidiUniversalGsReset) {
+            // System reset: controllers, notes and pitch bend back to defaults
+            midi_state_reset(&state->channels);
+        }
+        entry.universal.data = NULL; // Points into the event, not kept
+    } else if((status = midi_param_decode(data, length, &change)) == MidiParamOk) {
+        midi_param_write_from_change(&change, &entry.param);
+        entry.kind = MidiHistoryParam;
+#if MIDI_FEATURE_ANALYZERS
+        midi_param_table_apply(&state->params, &change);
+#endif
+    }
+#if MIDI_FEATURE_ANALYZERS
+    else if(status == MidiParamBadChecksum) {
+        state->param_checksum_errors++;
+    }
+#endif
+    
+    add_midi_message(state, &entry);
+}
+
+#if MIDI_FEATURE_RECORDER
+static void trace_clock(MidiApp* app, uint32_t tick) {
+    app->trace_clock = tick;
+    MIDI_TRACE(app, MidiTraceInstant, MidiTraceClock, tick & 0xFFFFFF);
+}
+
+// The trace runs with the capture
+static void recording_start(MidiApp* app) {
+    if(!midi_recorder_start(app->recorder)) return;
+    midi_trace_reset(&app->trace);
+    app->trace.enabled = true;
+    trace_clock(app, furi_get_tick());
+}
+
+// Path of a file saved next to the capture, e.g. capture_000.mtrc
+static void capture_sidecar(MidiApp* app, const char* extension, char* path, size_t size) {
+    const char* capture = midi_recorder_path(app->recorder);
+    const char* dot = strrchr(capture, '.');
+    size_t stem = dot ? (size_t)(dot - capture) : strlen(capture);
+    snprintf(path, size, "%.*s%s", (int)stem, capture, extension);
+}
+
+// Capture metadata: session counters and the last stall post-mortem
+static void capture_save_meta(MidiApp* app) {
+    char path[128];
+    char text[384];
+    capture_sidecar(app, ".meta", path, sizeof(path));
+    size_t length = snprintf(
+        text,
+        sizeof(text),
+        "records: %lu\ndropped: %lu\n",
+        (unsigned long)midi_recorder_records(app->recorder),
+        (unsigned long)midi_recorder_dropped(app->recorder));
+#if MIDI_FEATURE_DIAGNOSTICS
+    length += snprintf(
+        text + length,
+        sizeof(text) - length,
+        "stalls: %lu\nqueue_lost: %lu\n",
+        (unsigned long)app->watchdog.stalls,
+        (unsigned long)app->queue_dropped);
+    if(app->postmortem_valid) {
+        length += midi_postmortem_format(&app->postmortem, text + length, sizeof(text) - length);
     }
+#endif
+    if(!midi_store_save(path, text, length)) FURI_LOG_E(TAG, "Cannot write %s", path);
 }
-*/
+
+// Stop both and save the trace as capture_NNN.mtrc, next to the metadata
+static void recording_stop(MidiApp* app) {
+    // On a busy capture the earlier clocks have been overwritten: the newest
+    // event is one, and the header carries its full tick to anchor the timeline
+    trace_clock(app, furi_get_tick());
+    app->trace.enabled = false;
+    midi_recorder_stop(app->recorder);
+    capture_save_meta(app);
+
+    char path[128];
+    capture_sidecar(app, MIDI_TRACE_EXTENSION, path, sizeof(path));
+
+    // One SD write for the whole ring (4 KB) rather than one per event
+    uint8_t* file = malloc(MIDI_TRACE_FILE_SIZE(MIDI_TRACE_EVENTS));
+    uint32_t cycles_per_second = furi_hal_cortex_instructions_per_microsecond() * 1000000;
+    size_t size = midi_trace_encode(&app->trace, cycles_per_second, app->trace_clock, file);
+    if(!midi_store_save(path, file, size)) FURI_LOG_E(TAG, "Cannot write %s", path);
+    free(file);
+}
+
+// Up toggles the capture once the main loop has released the app mutex:
+// opening the file and saving the trace block on the SD card
+static void recording_toggle(MidiApp* app) {
+    if(!app->recording_toggle) return;
+    app->recording_toggle = false;
+    if(midi_recorder_is_active(app->recorder)) {
+        recording_stop(app);
+    } else {
+        recording_start(app);
+    }
+}
+#endif
+
+#if MIDI_FEATURE_OUTPUT
+// Velocity curve file, written when the velocity screen changed the curve.
+// Called without the app mutex: only the main loop touches the table.
+static void velocity_store(MidiApp* app) {
+    if(app->velocity_store == MidiVelocityStoreSave) {
+        uint8_t file[MIDI_VELOCITY_FILE_SIZE];
+        midi_velocity_lut_encode(app->velocity_lut, file);
+        if(!midi_store_save(MIDI_STORE_VELOCITY, file, sizeof(file))) {
+            FURI_LOG_W(TAG, "Velocity curve not saved");
+        }
+    } else if(app->velocity_store == MidiVelocityStoreRemove) {
+        midi_store_remove(MIDI_STORE_VELOCITY);
+    }
+    app->velocity_store = MidiVelocityStoreNone;
+}
+#endif
 
 // Initialize USB MIDI interface
 static bool init_usb_midi(MidiApp* app) {
@@ -292,8 +461,53 @@ int32_t midi_main(void* p) {
     MidiApp* app = malloc(sizeof(MidiApp));
     app->state = malloc(sizeof(MidiState));
     memset(app->state, 0, sizeof(MidiState));
+    midi_state_reset(&app->state->channels);
+    midi_decoder_init(&app->decoder, app->sysex_buffer, sizeof(app->sysex_buffer));
+    app->sysex_long_busy = false;
+#if MIDI_FEATURE_ANALYZERS
+    midi_param_table_init(&app->state->params, app->state->param_entries, MIDI_PARAM_TABLE_SIZE);
+    midi_universal_state_reset(&app->state->universal);
+    midi_meters_reset(&app->state->meters);
+    midi_jitter_reset(&app->state->jitter);
+#endif
     app->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
-    app->event_queue = furi_message_queue_alloc(16, sizeof(MidiEvent));
+    uint32_t queue_length = MIDI_EVENT_QUEUE_SIZE;
+#if MIDI_FEATURE_DIAGNOSTICS
+    queue_length = midi_diag_queue_length(app);
+#endif
+    app->event_queue = furi_message_queue_alloc(queue_length, sizeof(MidiEvent));
+#if MIDI_FEATURE_RECORDER
+    app->recorder = midi_recorder_alloc();
+    midi_trace_init(&app->trace, app->trace_events, MIDI_TRACE_EVENTS);
+    app->recording_toggle = false;
+#endif
+#if MIDI_FEATURE_VIEWS
+    memset(&app->monitor, 0, sizeof(app->monitor));
+    app->monitor_drawn = 0;
+    app->latency_reset = false;
+    app->monitor_redraw = false;
+    midi_latency_reset(&app->latency_history);
+    midi_latency_reset(&app->latency_monitor);
+#endif
+#if MIDI_FEATURE_SERVICE
+    app->service = midi_service_alloc(&app->state->channels);
+#endif
+#if MIDI_FEATURE_OUTPUT
+    app->din = midi_din_alloc();
+    midi_thru_init(&app->thru);
+    app->state->playout_percentile = 95;
+    app->velocity_store = MidiVelocityStoreNone;
+#if MIDI_FEATURE_ANALYZERS
+    app->thru.jitter = &app->state->jitter; // Hysteresis only for controls flagged as jittery
+#endif
+    // Velocity curve from the last calibration
+    uint8_t velocity_file[MIDI_VELOCITY_FILE_SIZE];
+    size_t velocity_length =
+        midi_store_load(MIDI_STORE_VELOCITY, velocity_file, sizeof(velocity_file));
+    if(midi_velocity_lut_decode(velocity_file, velocity_length, app->velocity_lut)) {
+        app->thru.velocity = app->velocity_lut;
+    }
+#endif
     
     // Initialize USB MIDI
     app->state->usb_connected = init_usb_midi(app);
@@ -305,6 +519,14 @@ int32_t midi_main(void* p) {
     view_port_input_callback_set(app->view_port, input_callback, app);
     gui_add_view_port(gui, app->view_port, GuiLayerFullscreen);
     
+#if MIDI_FEATURE_DIAGNOSTICS
+    midi_diag_start(app);
+#if MIDI_FEATURE_VIEWS
+    // A stall in an earlier session: show its post-mortem first
+    if(app->postmortem_valid) app->state->view = MidiViewDiagnostics;
+#endif
+#endif
+    
     FURI_LOG_I(TAG, "GUI initialized, entering main loop");
     
     // Main event loop
@@ -313,17 +535,83 @@ int32_t midi_main(void* p) {
     
     while(running) {
         // Wait for events with 100ms timeout
-        if(furi_message_queue_get(app->event_queue, &event, 100) == FuriStatusOk) {
+        MIDI_LOOP_STAGE(app, MidiLoopWait);
+        FuriStatus status = furi_message_queue_get(app->event_queue, &event, 100);
+#if MIDI_FEATURE_DIAGNOSTICS
+        midi_watchdog_kick(&app->watchdog, furi_get_tick());
+#endif
+#if MIDI_FEATURE_VIEWS
+        // Fast monitor: a redraw the receive path could not request, first
+        if(__atomic_exchange_n(&app->monitor_redraw, false, __ATOMIC_ACQUIRE)) {
+            view_port_update(app->view_port);
+        }
+#endif
+        if(status == FuriStatusOk) {
+            MIDI_TRACE(
+                app, MidiTraceCounter, MidiTraceQueue, furi_message_queue_get_count(app->event_queue));
+#if MIDI_FEATURE_DIAGNOSTICS
+            // Only this loop takes events, so the depth before the take is the peak since the last one
+            uint32_t depth = furi_message_queue_get_count(app->event_queue) + 1;
+#endif
+            MIDI_LOOP_STAGE(app, MidiLoopLock);
             furi_mutex_acquire(app->mutex, FuriWaitForever);
+            MIDI_LOOP_STAGE(app, MidiLoopKey + event.type);
+#if MIDI_FEATURE_DIAGNOSTICS
+            midi_queue_stats_take(&app->queue_stats, depth, midi_cycles(), furi_get_tick());
+#endif
+            MIDI_TRACE(app, MidiTraceBegin, MidiTraceMainLock, event.type);
             
             switch(event.type) {
             case EventTypeKey:
-                if(event.input.type == InputTypePress || event.input.type == InputTypeRepeat) {
+                if(event.input.type == InputTypePress &&
+                   (event.input.key == InputKeyLeft || event.input.key == InputKeyRight)) {
+                    // Switch screen
+                    MidiView view = app->state->view;
+                    view = (event.input.key == InputKeyRight) ? view + 1 : view + MidiViewCount - 1;
+                    app->state->view = view % MidiViewCount;
+                }
+#if MIDI_FEATURE_VIEWS
+                else if(app->state->view == MidiViewMonitor && event.input.key != InputKeyBack) {
+                    midi_view_monitor_input(app, &event.input);
+                }
+#endif
+#if MIDI_FEATURE_VIEWS && MIDI_FEATURE_ANALYZERS
+                else if(app->state->view == MidiViewParams && event.input.key != InputKeyBack) {
+                    midi_view_params_input(app, &event.input);
+                }
+                else if(app->state->view == MidiViewJitter && event.input.key != InputKeyBack) {
+                    midi_view_jitter_input(app, &event.input);
+                }
+#endif
+#if MIDI_FEATURE_VIEWS && MIDI_FEATURE_DIAGNOSTICS
+                else if(app->state->view == MidiViewDiagnostics && event.input.key != InputKeyBack) {
+                    midi_view_diagnostics_input(app, &event.input);
+                }
+#endif
+#if MIDI_FEATURE_VIEWS && MIDI_FEATURE_OUTPUT
+                else if(app->state->view == MidiViewVelocity && event.input.key != InputKeyBack) {
+                    midi_view_velocity_input(app, &event.input);
+                }
+                else if(app->state->view == MidiViewPlayout && event.input.key != InputKeyBack) {
+                    midi_view_playout_input(app, &event.input);
+                }
+                else if(app->state->view == MidiViewLinkTest && event.input.key != InputKeyBack) {
+                    midi_view_link_test_input(app, &event.input);
+                }
+#endif
+                else if(event.input.type == InputTypePress || event.input.type == InputTypeRepeat) {
                     if(event.input.key == InputKeyOk) {
                         // Clear message history
                         FURI_LOG_I(TAG, "Clearing MIDI message history");
                         app->state->message_count = 0;
-                    } else if(event.input.key == InputKeyBack) {
+                    }
+#if MIDI_FEATURE_RECORDER
+                    else if(event.input.key == InputKeyUp && event.input.type == InputTypePress) {
+                        // Start/stop capturing to SD card, after the mutex is released
+                        app->recording_toggle = true;
+                    }
+#endif
+                    else if(event.input.key == InputKeyBack) {
                         // Exit the application
                         FURI_LOG_I(TAG, "Exit requested");
                         running = false;
@@ -331,13 +619,42 @@ int32_t midi_main(void* p) {
                 }
                 break;
                 
-            case EventTypeMidi:
+            case EventTypeMidi: {
                 // New MIDI message received
-                add_midi_message(app->state, &event.midi);
+                MidiHistoryEntry entry = {.message = event.midi, .kind = MidiHistoryMessage};
+                add_midi_message(app->state, &entry);
+                midi_state_apply(&app->state->channels, &event.midi);
+#if MIDI_FEATURE_VIEWS
+                if(app->state->view == MidiViewHistory) {
+                    app->state->draw_arrival = event.arrival;
+                    app->state->draw_pending = true;
+                }
+#endif
+#if MIDI_FEATURE_ANALYZERS
+                midi_meters_apply(&app->state->meters, &event.midi);
+                midi_jitter_apply(&app->state->jitter, &event.midi);
+#endif
+#if MIDI_FEATURE_OUTPUT
+                if(app->state->velocity_collecting && event.midi.type == MidiNoteOn) {
+                    midi_velocity_histogram_add(&app->state->velocity_histogram, event.midi.data2);
+                }
+#endif
                 FURI_LOG_I(TAG, "MIDI message: Type=0x%02X Ch=%d D1=%d D2=%d",
                           event.midi.type, event.midi.channel, 
                           event.midi.data1, event.midi.data2);
                 break;
+            }
+                
+            case EventTypeSysex:
+                if(event.sysex.length == 0) {
+                    handle_sysex(
+                        app->state, event.sysex.timestamp, app->sysex_long, app->sysex_long_length);
+                    __atomic_store_n(&app->sysex_long_busy, false, __ATOMIC_RELEASE);
+                } else {
+                    handle_sysex(
+                        app->state, event.sysex.timestamp, event.sysex.data, event.sysex.length);
+                }
+                break;
                 
             case EventTypeUsbStatus:
                 // USB connection status changed
@@ -347,24 +664,66 @@ int32_t midi_main(void* p) {
                 break;
             }
             
+            MIDI_TRACE(app, MidiTraceEnd, MidiTraceMainLock, 0);
             furi_mutex_release(app->mutex);
+            MIDI_LOOP_STAGE(app, MidiLoopRedraw);
             view_port_update(app->view_port);
         }
         
+#if MIDI_FEATURE_RECORDER
+        // SD writes happen here, never in the USB receive path
+        MIDI_LOOP_STAGE(app, MidiLoopFlush);
+        recording_toggle(app);
+        midi_recorder_flush(app->recorder);
+        uint32_t tick = furi_get_tick();
+        if(app->trace.enabled && !midi_recorder_is_active(app->recorder)) {
+            recording_stop(app); // Capture stopped on an SD error, keep the trace up to there
+        } else if(app->trace.enabled && tick - app->trace_clock >= MIDI_TRACE_CLOCK_MS) {
+            trace_clock(app, tick);
+        }
+#endif
+#if MIDI_FEATURE_OUTPUT
+        MIDI_LOOP_STAGE(app, MidiLoopFlush);
+        velocity_store(app);
+#endif
+        
         // Update blink counter for USB icon animation (runs every loop iteration)
+        MIDI_LOOP_STAGE(app, MidiLoopLock);
         furi_mutex_acquire(app->mutex, FuriWaitForever);
         app->state->blink_counter++;
+#if MIDI_FEATURE_DIAGNOSTICS
+        if(furi_message_queue_get_count(app->event_queue) == 0) {
+            midi_queue_stats_idle(
+                &app->queue_stats, app->queue_dropped, midi_cycles(), furi_get_tick());
+        }
+#endif
         furi_mutex_release(app->mutex);
         
         // Trigger redraw for USB icon blinking animation
+        MIDI_LOOP_STAGE(app, MidiLoopRedraw);
         view_port_update(app->view_port);
     }
     
     FURI_LOG_I(TAG, "Cleaning up...");
     
+#if MIDI_FEATURE_DIAGNOSTICS
+    midi_diag_stop(app);
+#endif
+    
     // Cleanup USB
     deinit_usb_midi();
     
+#if MIDI_FEATURE_RECORDER
+    if(midi_recorder_is_active(app->recorder)) recording_stop(app);
+    midi_recorder_free(app->recorder);
+#endif
+#if MIDI_FEATURE_OUTPUT
+    if(app->din) midi_din_free(app->din);
+#endif
+#if MIDI_FEATURE_SERVICE
+    midi_service_free(app->service);
+#endif
+    
     // Cleanup GUI and resources
     gui_remove_view_port(gui, app->view_port);
     view_port_free(app->view_port);
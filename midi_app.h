@@ -0,0 +1,313 @@
+#pragma once
+
+// Application types shared by midi.c and the optional views in midi_views.c
+
+#include <furi.h> // Flipper Universal Registry Implementation = Core OS functionality
+#include <furi_hal.h> // Hardware abstraction layer
+#include <gui/gui.h> // GUI system
+#include <input/input.h> // Input handling (buttons)
+#include "midi_config.h" // Build-time feature modules
+#include "midi_core.h" // Portable decoder, SysEx reassembly, channel state
+#include "midi_param.h" // Roland/Yamaha parameter-change SysEx
+#include "midi_universal.h" // Universal SysEx (MMC, master volume, GM/GS reset, MTS)
+#include "midi_meter.h" // Per-channel activity meters
+#include "midi_jitter.h" // Jittery controller detection
+#include "midi_thru.h" // Thru stages and encoding
+#include "midi_profile.h" // Latency statistics
+#include "midi_store.h" // Settings files on SD
+#if MIDI_FEATURE_RECORDER
+#include "midi_recorder.h" // Capture to SD card
+#include "midi_trace.h" // Timeline trace saved with the capture
+#endif
+#if MIDI_FEATURE_OUTPUT
+#include "midi_din.h" // DIN port on the USART, link test
+#endif
+#if MIDI_FEATURE_SERVICE
+#include "midi_service.h" // Decoded MIDI for in-process consumers
+#endif
+#if MIDI_FEATURE_DIAGNOSTICS
+#include "midi_watchdog.h" // Main loop stall detection
+#include "midi_queue_stats.h" // Event queue bursts and sizing
+#endif
+
+#define TAG "Mitzi_Midi"
+#define MAX_MIDI_MESSAGES 3 // Number of MIDI messages to display in history
+#define MIDI_SYSEX_BUFFER_SIZE MIDI_MTS_NOTE_CHANGE_MAX // Longest SysEx kept in full (MTS)
+#define MIDI_SYSEX_EVENT_SIZE 32 // Longest SysEx forwarded to the main loop (knob-turn sized)
+#define MIDI_RX_BATCH 16 // Messages decoded per USB transfer before queuing
+#define MIDI_PARAM_TABLE_SIZE 128 // Parameter table slots (power of two, 3/4 usable)
+#define MIDI_TRACE_EVENTS 512 // Trace ring (power of two, 4 KB)
+#define MIDI_WATCHDOG_DEADLINE_MS 250 // Waiting events left alone longer than this are a stall
+#define MIDI_WATCHDOG_PERIOD_MS 50
+#define MIDI_EVENT_QUEUE_SIZE 16 // Event queue length without burst statistics
+#define MIDI_EVENT_QUEUE_MIN 8
+#define MIDI_EVENT_QUEUE_BUDGET 3072 // Bytes the event queue may take when sized from statistics
+#define MIDI_EVENT_QUEUE_MAX (MIDI_EVENT_QUEUE_BUDGET / sizeof(MidiEvent))
+
+typedef enum {
+    MidiHistoryMessage,   // Plain message (SysEx: "System 0xF0")
+    MidiHistoryParam,     // SysEx decoded as parameter change
+    MidiHistoryUniversal, // SysEx decoded as universal message
+} MidiHistoryKind;
+
+// One line of the message history
+typedef struct {
+    MidiMessage message;  // SysEx: status 0xF0, data1 = manufacturer ID
+    MidiHistoryKind kind;
+    union {
+        MidiParamWrite param;
+        MidiUniversalEvent universal; // data is NULL once stored
+    };
+} MidiHistoryEntry;
+
+// Screens, cycled with Left/Right
+typedef enum {
+    MidiViewHistory,
+#if MIDI_FEATURE_VIEWS
+    MidiViewMonitor,      // Newest message only, redrawn as soon as it arrives
+#endif
+#if MIDI_FEATURE_VIEWS && MIDI_FEATURE_ANALYZERS
+    MidiViewParams,       // Changed parameters from parameter-change SysEx
+    MidiViewMeters,       // Activity bars of the 16 channels
+    MidiViewJitter,       // Controllers bouncing between adjacent values
+#endif
+#if MIDI_FEATURE_VIEWS && MIDI_FEATURE_DIAGNOSTICS
+    MidiViewDiagnostics,  // Last main loop stall, event queue sizing
+#endif
+#if MIDI_FEATURE_VIEWS && MIDI_FEATURE_OUTPUT
+    MidiViewVelocity,     // Velocity curve calibration
+    MidiViewPlayout,      // Dejitter buffer on the DIN thru
+    MidiViewLinkTest,     // DIN loopback byte error rate
+#endif
+    MidiViewCount
+} MidiView;
+
+#if MIDI_FEATURE_DIAGNOSTICS
+// What the main loop and the GUI are doing, for the stall post-mortem
+// (names in midi_diag.c)
+typedef enum {
+    MidiLoopWait,      // Waiting for an event
+    MidiLoopLock,      // Waiting for the app mutex
+    MidiLoopKey,       // Handling an event, same order as EventType
+    MidiLoopMidi,
+    MidiLoopSysex,
+    MidiLoopUsbStatus,
+    MidiLoopFlush,     // Capture SD writes
+    MidiLoopRedraw,    // Requesting a redraw
+    MidiLoopStageCount
+} MidiLoopStage;
+
+typedef enum {
+    MidiRenderIdle,
+    MidiRenderLock,    // Waiting for the app mutex
+    MidiRenderDraw,
+    MidiRenderStageCount
+} MidiRenderStage;
+#endif
+
+#if MIDI_FEATURE_OUTPUT
+// Velocity curve file change asked for on the velocity screen
+typedef enum {
+    MidiVelocityStoreNone,
+    MidiVelocityStoreSave,   // Write app->velocity_lut
+    MidiVelocityStoreRemove, // Curve turned off
+} MidiVelocityStore;
+#endif
+
+// Application state
+typedef struct {
+    MidiHistoryEntry messages[MAX_MIDI_MESSAGES]; // Ring buffer of received messages
+    uint8_t message_count;                   // Total messages received
+    bool usb_connected;                      // USB connection status
+    uint32_t last_message_time;              // Timestamp of last message
+    uint32_t blink_counter;                  // Counter for USB icon blinking
+    MidiView view;                           // Screen shown
+    MidiChannelState channels;               // Notes held, controller values etc. per channel
+#if MIDI_FEATURE_VIEWS
+    uint32_t draw_arrival;                   // Arrival (cycles) of the newest message not drawn yet
+    bool draw_pending;
+#endif
+#if MIDI_FEATURE_ANALYZERS
+    MidiParamTable params;                   // Parameter values by address
+    MidiParamEntry param_entries[MIDI_PARAM_TABLE_SIZE];
+    uint32_t param_checksum_errors;          // Roland DT1 with bad checksum
+    MidiUniversalState universal;            // Master volume, GM mode, MTS tuning tables
+    MidiMeters meters;                       // Last hit per channel, decayed when drawn
+    MidiJitter jitter;                       // ±1 reversal score per channel and controller
+#endif
+#if MIDI_FEATURE_VIEWS && MIDI_FEATURE_ANALYZERS
+    uint8_t params_scroll;                   // First dirty entry shown
+    uint8_t jitter_scroll;                   // First jittery control shown
+#endif
+#if MIDI_FEATURE_VIEWS && MIDI_FEATURE_DIAGNOSTICS
+    bool diagnostics_queue;                  // Queue page instead of the stall page
+#endif
+#if MIDI_FEATURE_OUTPUT
+    MidiVelocityHistogram velocity_histogram; // Note On velocities played while calibrating
+    bool velocity_collecting;
+    uint8_t velocity_target;                 // Index into midi_velocity_targets
+    uint8_t playout_percentile;              // Transit jitter covered by the playout delay
+#endif
+} MidiState;
+
+// Event types for the application
+typedef enum {
+    EventTypeKey,        // User input event
+    EventTypeMidi,       // MIDI data received
+    EventTypeSysex,      // Complete short SysEx message received
+    EventTypeUsbStatus   // USB connection status change
+} EventType;
+
+// Short SysEx copied out of the reassembly buffer
+typedef struct {
+    uint32_t timestamp;
+    uint8_t length;                      // 0: longer universal SysEx in MidiApp.sysex_long
+    uint8_t data[MIDI_SYSEX_EVENT_SIZE]; // F0 ... F7
+} MidiSysexEvent;
+
+// Application event structure
+typedef struct {
+    EventType type;
+    uint32_t arrival;          // DWT cycle counter when the USB transfer arrived
+    union {
+        InputEvent input;      // For keyboard events
+        MidiMessage midi;      // For MIDI events
+        MidiSysexEvent sysex;  // For SysEx events
+        bool usb_connected;    // For USB status events
+    };
+} MidiEvent;
+
+#if MIDI_FEATURE_VIEWS
+// Newest message for the fast monitor, written by the receive path without
+// locks. The sequence number is odd while a write is in progress.
+typedef struct {
+    volatile uint32_t sequence;
+    MidiMessage message;
+    uint32_t arrival;
+} MidiMonitorSlot;
+#endif
+
+// Main application context
+typedef struct {
+    MidiState* state;
+    FuriMutex* mutex;
+    FuriMessageQueue* event_queue;
+    ViewPort* view_port;
+    MidiDecoder decoder;                     // USB packet decoder (USB receive context only)
+    uint8_t sysex_buffer[MIDI_SYSEX_BUFFER_SIZE];
+    uint8_t sysex_long[MIDI_SYSEX_BUFFER_SIZE]; // Universal SysEx too long for an event (MTS dumps)
+    size_t sysex_long_length;
+    bool sysex_long_busy;                    // Set by the receive path, cleared by the main loop
+#if MIDI_FEATURE_RECORDER
+    MidiRecorder* recorder;                  // Raw packet capture, toggled with Up
+    MidiTrace trace;                         // Recorded while capturing, saved next to it
+    MidiTraceEvent trace_events[MIDI_TRACE_EVENTS];
+    uint32_t trace_clock;                    // Kernel tick of the last MidiTraceClock
+    bool recording_toggle;                   // Up pressed, handled by the main loop outside the mutex
+#endif
+#if MIDI_FEATURE_OUTPUT
+    MidiDin* din;                            // NULL if the USART is in use elsewhere
+    MidiThru thru;                           // USB in to DIN out (USB receive context only)
+    uint8_t velocity_lut[MIDI_VELOCITY_LUT_SIZE]; // Curve installed in the thru
+    MidiVelocityStore velocity_store;        // Done by the main loop outside the mutex
+#endif
+#if MIDI_FEATURE_SERVICE
+    MidiService* service;                    // RECORD_MIDI, fed from the USB receive path
+#endif
+#if MIDI_FEATURE_VIEWS
+    MidiMonitorSlot monitor;                 // Filled while the monitor screen is shown
+    uint32_t monitor_drawn;                  // Sequence number of the message last drawn
+    MidiMessage monitor_shown;               // Last message read completely (GUI thread only)
+    MidiLatency latency_history;             // Arrival to end of draw (us), history screen
+    MidiLatency latency_monitor;             // Same for the fast monitor (GUI thread only)
+    volatile bool latency_reset;             // Set by OK on the monitor, done by the next draw
+    bool monitor_redraw;                     // Redraw left to the main loop (receive path in an interrupt)
+#endif
+#if MIDI_FEATURE_DIAGNOSTICS
+    MidiWatchdog watchdog;                   // Kicked by the main loop, checked by its own thread
+    MidiStage loop_stage;                    // MidiLoopStage
+    MidiStage render_stage;                  // MidiRenderStage
+    volatile uint32_t queue_dropped;         // Events lost to a full queue
+    FuriThread* watchdog_thread;
+    MidiPostMortem postmortem;               // Last stall, this or an earlier session
+    volatile bool postmortem_valid;
+    MidiQueueStats queue_stats;              // Drain in cycles, gaps in ms; app mutex held
+#endif
+} MidiApp;
+
+static inline uint32_t midi_cycles(void) {
+    return DWT->CYCCNT;
+}
+
+static inline uint32_t midi_cycles_to_us(uint32_t cycles) {
+    return cycles / furi_hal_cortex_instructions_per_microsecond();
+}
+
+// Stage markers for the watchdog; compiled out without diagnostics
+#if MIDI_FEATURE_DIAGNOSTICS
+#define MIDI_LOOP_STAGE(app, value) midi_stage_set(&(app)->loop_stage, value, furi_get_tick())
+#define MIDI_RENDER_STAGE(app, value) midi_stage_set(&(app)->render_stage, value, furi_get_tick())
+#else
+#define MIDI_LOOP_STAGE(app, value) \
+    do {                            \
+    } while(0)
+#define MIDI_RENDER_STAGE(app, value) \
+    do {                              \
+    } while(0)
+#endif
+
+// Trace event at the current cycle count; compiled out without the recorder
+#if MIDI_FEATURE_RECORDER
+#define MIDI_TRACE(app, type, id, arg) midi_trace_add(&(app)->trace, midi_cycles(), type, id, arg)
+#else
+#define MIDI_TRACE(app, type, id, arg) \
+    do {                               \
+    } while(0)
+#endif
+
+// USB receive path: decodes a transfer of 4-byte USB MIDI packets and queues the events.
+// To be registered with the USB MIDI class once the HAL integration is done.
+void midi_usb_rx(MidiApp* app, const uint8_t* data, size_t length);
+
+#if MIDI_FEATURE_DIAGNOSTICS
+// Stall watchdog (midi_diag.c): loads the last post-mortem and starts the
+// watchdog thread; stop before freeing the queue and the mutex
+void midi_diag_start(MidiApp* app);
+void midi_diag_stop(MidiApp* app);
+// Forget the post-mortem (also on SD)
+void midi_diag_clear(MidiApp* app);
+// Loads the queue statistics of earlier sessions and returns the event queue
+// length to allocate; the statistics are saved by midi_diag_stop()
+uint32_t midi_diag_queue_length(MidiApp* app);
+// Forget the queue statistics of all sessions (also on SD)
+void midi_diag_queue_clear(MidiApp* app);
+#endif
+
+#if MIDI_FEATURE_VIEWS
+// Fast monitor (midi_views.c). Publish runs in the receive path, the draw
+// in the GUI thread without the app mutex.
+void midi_monitor_publish(MidiMonitorSlot* slot, const MidiMessage* message, uint32_t arrival);
+void midi_view_monitor_draw(Canvas* canvas, MidiApp* app);
+void midi_view_monitor_input(MidiApp* app, const InputEvent* input);
+
+// Optional screens (midi_views.c). Called with the app mutex held.
+#if MIDI_FEATURE_ANALYZERS
+void midi_view_params_draw(Canvas* canvas, MidiApp* app);
+void midi_view_params_input(MidiApp* app, const InputEvent* input);
+void midi_view_meters_draw(Canvas* canvas, MidiApp* app);
+void midi_view_jitter_draw(Canvas* canvas, MidiApp* app);
+void midi_view_jitter_input(MidiApp* app, const InputEvent* input);
+#endif
+#if MIDI_FEATURE_DIAGNOSTICS
+void midi_view_diagnostics_draw(Canvas* canvas, MidiApp* app);
+void midi_view_diagnostics_input(MidiApp* app, const InputEvent* input);
+#endif
+#if MIDI_FEATURE_OUTPUT
+void midi_view_velocity_draw(Canvas* canvas, MidiApp* app);
+void midi_view_velocity_input(MidiApp* app, const InputEvent* input);
+void midi_view_playout_draw(Canvas* canvas, MidiApp* app);
+void midi_view_playout_input(MidiApp* app, const InputEvent* input);
+void midi_view_link_test_draw(Canvas* canvas, MidiApp* app);
+void midi_view_link_test_input(MidiApp* app, const InputEvent* input);
+#endif
+#endif
@@ -0,0 +1,58 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_SERVICE
+
+#include "midi_bus.h"
+
+#include <string.h>
+
+void midi_bus_init(MidiBus* bus, MidiMessage* records, uint32_t capacity) {
+    memset(bus, 0, sizeof(MidiBus));
+    bus->records = records;
+    bus->capacity = capacity;
+}
+
+int midi_bus_subscribe(MidiBus* bus, uint8_t mask) {
+    for(int i = 0; i < MIDI_BUS_CONSUMERS; i++) {
+        MidiBusConsumer* c = &bus->consumers[i];
+        if(c->active) continue;
+        c->cursor = __atomic_load_n(&bus->head, __ATOMIC_ACQUIRE);
+        c->overflow = 0;
+        c->delivered = 0;
+        c->mask = mask;
+        __atomic_store_n(&c->active, true, __ATOMIC_RELEASE);
+        return i;
+    }
+    return -1;
+}
+
+void midi_bus_unsubscribe(MidiBus* bus, int consumer) {
+    if(consumer < 0 || consumer >= MIDI_BUS_CONSUMERS) return;
+    __atomic_store_n(&bus->consumers[consumer].active, false, __ATOMIC_RELEASE);
+}
+
+uint8_t midi_bus_publish(MidiBus* bus, const MidiMessage* messages, size_t count) {
+    uint32_t head = bus->head; // Only the producer writes it
+    uint8_t types = 0;
+
+    // More than fits: only the newest records survive anyway
+    if(count > bus->capacity) {
+        head += count - bus->capacity;
+        messages += count - bus->capacity;
+        count = bus->capacity;
+    }
+
+    // Readers check reserved after reading, so it has to change before the records do
+    __atomic_store_n(&bus->reserved, head + count, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    for(size_t i = 0; i < count; i++) {
+        bus->records[(head + i) & (bus->capacity - 1)] = messages[i];
+        types |= MIDI_BUS_TYPE_BIT(messages[i].status);
+    }
+
+    __atomic_store_n(&bus->head, head + count, __ATOMIC_RELEASE);
+    return types;
+}
+
+#endif // MIDI_FEATURE_SERVICE
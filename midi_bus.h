@@ -0,0 +1,97 @@
+#pragma once
+
+// Broadcast ring for decoded messages: one producer, up to
+// MIDI_BUS_CONSUMERS consumers, no copies.
+//
+// The producer never waits. Every consumer has its own read cursor; a
+// consumer that falls more than the ring capacity behind loses the oldest
+// records, which is counted in its own overflow counter and does not affect
+// the others. Consumers read records in place: midi_bus_peek() hands out a
+// contiguous run, midi_bus_release() advances past it and reports whether
+// the producer overwrote part of it in the meantime (seqlock-style check).
+//
+// The consumer side is inline so plugins can use it with only this header.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "midi_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIDI_BUS_CONSUMERS 4
+#define MIDI_BUS_TYPE_BIT(type) (1u << (((type) >> 4) & 0x07)) // MidiMessageType -> mask bit
+#define MIDI_BUS_ALL 0xFF
+
+typedef struct {
+    uint32_t cursor;    // Sequence number of the next record to read
+    uint32_t overflow;  // Records lost because the producer lapped this consumer
+    uint32_t delivered; // Records released intact (all types)
+    uint8_t mask;       // MIDI_BUS_TYPE_BIT() of the wanted message types
+    bool active;
+} MidiBusConsumer;
+
+typedef struct {
+    MidiMessage* records;
+    uint32_t capacity; // Power of two
+    uint32_t head;     // Records published
+    uint32_t reserved; // Records published or being written
+    MidiBusConsumer consumers[MIDI_BUS_CONSUMERS];
+} MidiBus;
+
+void midi_bus_init(MidiBus* bus, MidiMessage* records, uint32_t capacity);
+
+// Not safe against concurrent subscribe/unsubscribe calls: serialize them.
+// Returns the consumer id, -1 if all slots are taken. Reading starts with
+// the next record published.
+int midi_bus_subscribe(MidiBus* bus, uint8_t mask);
+void midi_bus_unsubscribe(MidiBus* bus, int consumer);
+
+// Producer side: append records, overwriting the oldest ones. Returns the
+// union of the type bits published, for waking up interested consumers.
+uint8_t midi_bus_publish(MidiBus* bus, const MidiMessage* messages, size_t count);
+
+static inline bool midi_bus_wants(const MidiBus* bus, int consumer, const MidiMessage* message) {
+    return bus->consumers[consumer].mask & MIDI_BUS_TYPE_BIT(message->status);
+}
+
+// Contiguous run of unread records (all types, filter with midi_bus_wants()).
+// Returns 0 when the consumer is up to date.
+static inline size_t midi_bus_peek(MidiBus* bus, int consumer, const MidiMessage** records) {
+    MidiBusConsumer* c = &bus->consumers[consumer];
+    uint32_t head = __atomic_load_n(&bus->head, __ATOMIC_ACQUIRE);
+    if(head - c->cursor > bus->capacity) {
+        // Lapped: skip to the oldest record still in the ring
+        c->overflow += head - c->cursor - bus->capacity;
+        c->cursor = head - bus->capacity;
+    }
+
+    uint32_t index = c->cursor & (bus->capacity - 1);
+    uint32_t count = head - c->cursor;
+    if(count > bus->capacity - index) count = bus->capacity - index;
+    *records = &bus->records[index];
+    return count;
+}
+
+// Done with count records from the last peek. Returns false if the producer
+// overwrote them while they were read: the run counts as overflow.
+static inline bool midi_bus_release(MidiBus* bus, int consumer, size_t count) {
+    MidiBusConsumer* c = &bus->consumers[consumer];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint32_t reserved = __atomic_load_n(&bus->reserved, __ATOMIC_RELAXED);
+    uint32_t start = c->cursor;
+    c->cursor += count;
+    if(reserved - start > bus->capacity) {
+        c->overflow += count;
+        return false;
+    }
+    c->delivered += count;
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,76 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_RECORDER
+
+#include "midi_capture.h"
+
+#include <string.h>
+
+static inline void put_le16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static inline void put_le32(uint8_t* out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = value >> 24;
+}
+
+static inline uint16_t get_le16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+static inline uint32_t get_le32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+void midi_capture_header_encode(const MidiCaptureHeader* header, uint8_t* out) {
+    memcpy(out, MIDI_CAPTURE_MAGIC, 4);
+    put_le16(&out[4], header->version);
+    put_le16(&out[6], header->record_size);
+    put_le32(&out[8], header->tick_hz);
+    put_le32(&out[12], header->start_time);
+}
+
+bool midi_capture_header_decode(const uint8_t* data, MidiCaptureHeader* header) {
+    if(memcmp(data, MIDI_CAPTURE_MAGIC, 4) != 0) return false;
+    header->version = get_le16(&data[4]);
+    header->record_size = get_le16(&data[6]);
+    header->tick_hz = get_le32(&data[8]);
+    header->start_time = get_le32(&data[12]);
+    return header->version == MIDI_CAPTURE_VERSION &&
+           header->record_size == MIDI_CAPTURE_RECORD_SIZE;
+}
+
+void midi_capture_record_encode(uint32_t timestamp, const uint8_t* packet, uint8_t* out) {
+    put_le32(out, timestamp);
+    memcpy(&out[4], packet, MIDI_USB_PACKET_SIZE);
+}
+
+size_t midi_capture_decode_records(
+    MidiDecoder* decoder,
+    const uint8_t* data,
+    size_t length,
+    MidiMessage* out,
+    size_t capacity,
+    size_t* consumed) {
+    size_t count = 0;
+    size_t i = 0;
+
+    while(i + MIDI_CAPTURE_RECORD_SIZE <= length && count < capacity) {
+        const uint8_t* record = &data[i];
+        i += MIDI_CAPTURE_RECORD_SIZE;
+        size_t n = midi_decode_packets(
+            decoder, &record[4], MIDI_USB_PACKET_SIZE, get_le32(record), &out[count], 1, NULL);
+        count += n;
+        // Hand a completed SysEx to the caller before the buffer is reused
+        if(n && decoder->sysex_done) break;
+    }
+
+    if(consumed) *consumed = i;
+    return count;
+}
+
+#endif // MIDI_FEATURE_RECORDER
@@ -0,0 +1,53 @@
+#pragma once
+
+// Capture file format shared by the device recorder and host tools.
+//
+// A capture is a 16-byte header followed by fixed-size records:
+//   header: "MMCP" | version u16 | record size u16 | tick rate u32 | start time u32
+//   record: timestamp u32 (ticks) | raw 4-byte USB MIDI packet
+// All integers are little endian. Raw packets are stored so SysEx survives
+// untouched; decode them with midi_capture_decode_records().
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "midi_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIDI_CAPTURE_MAGIC "MMCP"
+#define MIDI_CAPTURE_VERSION 1
+#define MIDI_CAPTURE_HEADER_SIZE 16
+#define MIDI_CAPTURE_RECORD_SIZE 8
+#define MIDI_CAPTURE_EXTENSION ".mcap"
+
+typedef struct {
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t tick_hz;    // Timestamp resolution (1000 on the Flipper)
+    uint32_t start_time; // Unix time the capture was started, 0 if unknown
+} MidiCaptureHeader;
+
+void midi_capture_header_encode(const MidiCaptureHeader* header, uint8_t* out);
+// Returns false if magic, version or record size do not match
+bool midi_capture_header_decode(const uint8_t* data, MidiCaptureHeader* header);
+
+void midi_capture_record_encode(uint32_t timestamp, const uint8_t* packet, uint8_t* out);
+
+// Decode a span of records (whole records only) into a caller-provided array.
+// Same contract as midi_decode_packets(): stops when out is full or after a
+// complete SysEx; consumed receives the number of bytes processed.
+size_t midi_capture_decode_records(
+    MidiDecoder* decoder,
+    const uint8_t* data,
+    size_t length,
+    MidiMessage* out,
+    size_t capacity,
+    size_t* consumed);
+
+#ifdef __cplusplus
+}
+#endif
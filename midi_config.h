@@ -0,0 +1,35 @@
+#pragma once
+
+// Build-time feature modules.
+// The .fap is loaded from SD card into RAM, so every subsystem can be switched
+// off independently via the cdefines in application.fam, e.g.
+//     cdefines=["APP_midi", "MIDI_FEATURE_ANALYZERS=0"],
+// A disabled module is removed by the preprocessor: every source file of a
+// module, the portable ones included, wraps its body in the module's #if, so
+// it costs neither flash nor RAM. Helpers shared by several modules
+// (midi_store, midi_profile) are built when any of their users is enabled.
+// Use tools/size_report.py on the linked build to see what each module costs.
+
+#ifndef MIDI_FEATURE_RECORDER
+#define MIDI_FEATURE_RECORDER 1 // Capture received MIDI to SD card
+#endif
+
+#ifndef MIDI_FEATURE_ANALYZERS
+#define MIDI_FEATURE_ANALYZERS 1 // Statistics and detectors fed by incoming MIDI
+#endif
+
+#ifndef MIDI_FEATURE_OUTPUT
+#define MIDI_FEATURE_OUTPUT 1 // MIDI out / thru (DIN via UART)
+#endif
+
+#ifndef MIDI_FEATURE_VIEWS
+#define MIDI_FEATURE_VIEWS 1 // Additional screens besides the message history
+#endif
+
+#ifndef MIDI_FEATURE_SERVICE
+#define MIDI_FEATURE_SERVICE 1 // Decoded MIDI for in-process consumers via furi_record (midi_service.h)
+#endif
+
+#ifndef MIDI_FEATURE_DIAGNOSTICS
+#define MIDI_FEATURE_DIAGNOSTICS 1 // Main loop stall watchdog with post-mortem record
+#endif
@@ -0,0 +1,319 @@
+#include "midi_core.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Bytes carried by a USB MIDI packet, indexed by CIN (USB MIDI 1.0, table 4-1)
+static const uint8_t midi_cin_lengths[16] = {
+    0, 0, 2, 3, // Reserved, reserved, 2-byte system common, 3-byte system common
+    3, 1, 2, 3, // SysEx start/continue, SysEx end with 1/2/3 bytes
+    3, 3, 3, 3, // Note Off, Note On, Poly-KeyPress, Control Change
+    2, 2, 3, 1, // Program Change, Channel Pressure, Pitch Bend, single byte
+};
+
+// Parse MIDI status byte to extract message type and channel
+void midi_parse_status(uint8_t status, MidiMessageType* type, uint8_t* channel) {
+    if(status < 0xF0) {
+        // Channel messages (0x80-0xEF)
+        *type = status & 0xF0;  // Upper nibble = message type
+        *channel = status & 0x0F; // Lower nibble = channel (0-15)
+    } else {
+        // System messages (0xF0-0xFF)
+        *type = MidiSystemMessage;
+        *channel = 0; // System messages don't have channels
+    }
+}
+
+uint8_t midi_cin_length(uint8_t cin) {
+    return midi_cin_lengths[cin & 0x0F];
+}
+
+void midi_sysex_init(MidiSysex* sysex, uint8_t* buffer, size_t capacity) {
+    sysex->buffer = buffer;
+    sysex->capacity = buffer ? capacity : 0;
+    midi_sysex_reset(sysex);
+}
+
+void midi_sysex_reset(MidiSysex* sysex) {
+    sysex->length = 0;
+    sysex->manufacturer = 0;
+    sysex->active = false;
+    sysex->overflow = false;
+}
+
+MidiSysexResult midi_sysex_feed_packet(MidiSysex* sysex, const uint8_t* packet) {
+    uint8_t cin = packet[0] & 0x0F; // Low nibble = CIN, high nibble = cable
+    if(cin < 0x4 || cin > 0x7) return MidiSysexNone;
+
+    // CIN 5 is also used for single-byte system common messages (e.g. Tune Request)
+    if(cin == 0x5 && !sysex->active && packet[1] != MIDI_SYSEX_END) return MidiSysexNone;
+
+    uint8_t count = midi_cin_lengths[cin];
+    for(uint8_t i = 0; i < count; i++) {
+        uint8_t byte = packet[1 + i];
+        if(byte == MIDI_SYSEX_START) {
+            // A new start always wins, an unterminated message is dropped
+            midi_sysex_reset(sysex);
+            sysex->active = true;
+        } else if(!sysex->active) {
+            continue; // Continuation without a start
+        }
+
+        if(sysex->length < sysex->capacity) {
+            sysex->buffer[sysex->length] = byte;
+        } else {
+            sysex->overflow = true;
+        }
+        if(sysex->length == 1) sysex->manufacturer = byte;
+        sysex->length++;
+
+        if(byte == MIDI_SYSEX_END) {
+            sysex->active = false;
+            return MidiSysexComplete;
+        }
+    }
+
+    return sysex->active ? MidiSysexPartial : MidiSysexNone;
+}
+
+void midi_decoder_init(MidiDecoder* decoder, uint8_t* sysex_buffer, size_t sysex_capacity) {
+    midi_sysex_init(&decoder->sysex, sysex_buffer, sysex_capacity);
+    decoder->sysex_done = false;
+}
+
+void midi_decoder_reset(MidiDecoder* decoder) {
+    midi_sysex_reset(&decoder->sysex);
+    decoder->sysex_done = false;
+}
+
+// Decode one packet. Returns true if msg was filled, decoder->sysex_done is set on a completed SysEx.
+static inline bool midi_decode_one(
+    MidiDecoder* decoder,
+    const uint8_t* packet,
+    uint32_t timestamp,
+    MidiMessage* msg) {
+    uint8_t cin = packet[0] & 0x0F; // Low nibble = CIN, high nibble = cable
+    uint8_t length = midi_cin_lengths[cin];
+    decoder->sysex_done = false;
+
+    // Skip if no valid MIDI message (reserved CINs)
+    if(length == 0) return false;
+
+    if(cin >= 0x4 && cin <= 0x7) {
+        MidiSysexResult result = midi_sysex_feed_packet(&decoder->sysex, packet);
+        if(result == MidiSysexPartial) return false;
+        if(result == MidiSysexComplete) {
+            msg->status = MIDI_SYSEX_START;
+            msg->data1 = decoder->sysex.manufacturer;
+            msg->data2 = 0;
+            msg->channel = 0;
+            msg->type = MidiSystemMessage;
+            msg->timestamp = timestamp;
+            decoder->sysex_done = true;
+            return true;
+        }
+        if(cin != 0x5) return false;
+        // CIN 5 outside of SysEx: single-byte system common, handled below
+    }
+
+    uint8_t status = packet[1];
+    if(status < 0x80) return false; // Running status is not allowed in USB MIDI
+
+    msg->status = status;
+    msg->data1 = (length > 1) ? packet[2] : 0;
+    msg->data2 = (length > 2) ? packet[3] : 0;
+    msg->timestamp = timestamp;
+    midi_parse_status(status, &msg->type, &msg->channel);
+    return true;
+}
+
+size_t midi_decode_packets(
+    MidiDecoder* decoder,
+    const uint8_t* data,
+    size_t length,
+    uint32_t timestamp,
+    MidiMessage* out,
+    size_t capacity,
+    size_t* consumed) {
+    size_t count = 0;
+    size_t i = 0;
+
+    while(i + MIDI_USB_PACKET_SIZE <= length && count < capacity) {
+        if(midi_decode_one(decoder, &data[i], timestamp, &out[count])) count++;
+        i += MIDI_USB_PACKET_SIZE;
+        if(decoder->sysex_done) break;
+    }
+
+    if(consumed) *consumed = i;
+    return count;
+}
+
+size_t midi_decode_packets_cb(
+    MidiDecoder* decoder,
+    const uint8_t* data,
+    size_t length,
+    uint32_t timestamp,
+    MidiMessageCallback callback,
+    void* ctx) {
+    size_t count = 0;
+
+    for(size_t i = 0; i + MIDI_USB_PACKET_SIZE <= length; i += MIDI_USB_PACKET_SIZE) {
+        MidiMessage msg;
+        if(midi_decode_one(decoder, &data[i], timestamp, &msg)) {
+            callback(&msg, ctx);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+const uint8_t* midi_decoder_sysex(const MidiDecoder* decoder, size_t* length) {
+    const MidiSysex* sysex = &decoder->sysex;
+    if(length) *length = (sysex->length < sysex->capacity) ? sysex->length : sysex->capacity;
+    return sysex->buffer;
+}
+
+void midi_state_reset(MidiChannelState* state) {
+    memset(state, 0, sizeof(MidiChannelState));
+    for(uint8_t ch = 0; ch < 16; ch++) {
+        state->pitch_bend[ch] = 8192;
+    }
+}
+
+static inline void midi_state_note(MidiChannelState* state, uint8_t ch, uint8_t note, uint8_t velocity) {
+    note &= 0x7F;
+    if(velocity > 0) {
+        state->notes[ch][note >> 5] |= ((uint32_t)1 << (note & 31));
+        state->velocity[ch][note] = velocity;
+    } else {
+        state->notes[ch][note >> 5] &= ~((uint32_t)1 << (note & 31));
+    }
+}
+
+// Shared by the single and batch entry points so the batch loop gets it inlined
+static inline void midi_state_apply_one(MidiChannelState* state, const MidiMessage* message) {
+    uint8_t ch = message->channel & 0x0F;
+
+    switch(message->type) {
+    case MidiNoteOn:
+        // Note On with velocity 0 is treated as Note Off
+        midi_state_note(state, ch, message->data1, message->data2);
+        break;
+    case MidiNoteOff:
+        midi_state_note(state, ch, message->data1, 0);
+        break;
+    case MidiControlChange:
+        state->cc[ch][message->data1 & 0x7F] = message->data2;
+        if(message->data1 == 120 || message->data1 == 123) {
+            // All Sound Off / All Notes Off
+            memset(state->notes[ch], 0, sizeof(state->notes[ch]));
+        }
+        break;
+    case MidiProgramChange:
+        state->program[ch] = message->data1;
+        break;
+    case MidiChannelAftertouch:
+        state->pressure[ch] = message->data1;
+        break;
+    case MidiPitchBend:
+        state->pitch_bend[ch] = ((message->data2 & 0x7F) << 7) | (message->data1 & 0x7F);
+        break;
+    default:
+        break;
+    }
+}
+
+void midi_state_apply(MidiChannelState* state, const MidiMessage* message) {
+    midi_state_apply_one(state, message);
+}
+
+void midi_state_apply_batch(MidiChannelState* state, const MidiMessage* messages, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        midi_state_apply_one(state, &messages[i]);
+    }
+}
+
+bool midi_state_note_is_on(const MidiChannelState* state, uint8_t channel, uint8_t note) {
+    note &= 0x7F;
+    return (state->notes[channel & 0x0F][note >> 5] >> (note & 31)) & 1;
+}
+
+uint8_t midi_state_notes_held(const MidiChannelState* state, uint8_t channel) {
+    uint8_t count = 0;
+    for(uint8_t i = 0; i < 4; i++) {
+        count += __builtin_popcount(state->notes[channel & 0x0F][i]);
+    }
+    return count;
+}
+
+// Convert MIDI note number to string representation (e.g., C4, A#5)
+void midi_note_to_string(uint8_t note, char* buffer, size_t size) {
+    static const char* const note_names[] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+    int octave = (note / 12) - 1; // Note 0 is C-1
+    uint8_t note_index = note % 12;
+    snprintf(buffer, size, "%s%d", note_names[note_index], octave);
+}
+
+// Format MIDI message for display
+void midi_format_message(const MidiMessage* msg, char* buffer, size_t size) {
+    char note_str[8];
+
+    switch(msg->type) {
+    case MidiNoteOn:
+        if(msg->data2 > 0) {
+            midi_note_to_string(msg->data1, note_str, sizeof(note_str));
+            snprintf(buffer, size, "NoteOn  Ch%02d %s Vel%03d",
+                    msg->channel + 1, note_str, msg->data2);
+        } else {
+            // Note On with velocity 0 is treated as Note Off
+            midi_note_to_string(msg->data1, note_str, sizeof(note_str));
+            snprintf(buffer, size, "NoteOff Ch%02d %s",
+                    msg->channel + 1, note_str);
+        }
+        break;
+
+    case MidiNoteOff:
+        midi_note_to_string(msg->data1, note_str, sizeof(note_str));
+        snprintf(buffer, size, "NoteOff Ch%02d %s Vel%03d",
+                msg->channel + 1, note_str, msg->data2);
+        break;
+
+    case MidiControlChange:
+        snprintf(buffer, size, "CC      Ch%02d #%03d=%03d",
+                msg->channel + 1, msg->data1, msg->data2);
+        break;
+
+    case MidiProgramChange:
+        snprintf(buffer, size, "ProgChg Ch%02d Prg%03d",
+                msg->channel + 1, msg->data1);
+        break;
+
+    case MidiPitchBend:
+        {
+            int16_t bend = ((msg->data2 << 7) | msg->data1) - 8192;
+            snprintf(buffer, size, "PitchBd Ch%02d %+05d",
+                    msg->channel + 1, bend);
+        }
+        break;
+
+    case MidiChannelAftertouch:
+        snprintf(buffer, size, "ChPress Ch%02d Val%03d",
+                msg->channel + 1, msg->data1);
+        break;
+
+    case MidiPolyAftertouch:
+        midi_note_to_string(msg->data1, note_str, sizeof(note_str));
+        snprintf(buffer, size, "PolyAT  Ch%02d %s P%03d",
+                msg->channel + 1, note_str, msg->data2);
+        break;
+
+    case MidiSystemMessage:
+        snprintf(buffer, size, "System  0x%02X", msg->status);
+        break;
+
+    default:
+        snprintf(buffer, size, "Unknown 0x%02X", msg->status);
+        break;
+    }
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+// Portable MIDI core: USB MIDI packet decoder, SysEx reassembler, channel
+// state tracker and message formatting.
+// No Flipper dependencies and no globals: all state lives in structs owned
+// by the caller and all buffers are caller-provided, so the same code runs
+// on the device and in host tools (see host/).
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// MIDI message types (status bytes)
+typedef enum {
+    MidiNoteOff = 0x80,          // Note Off
+    MidiNoteOn = 0x90,           // Note On
+    MidiPolyAftertouch = 0xA0,   // Polyphonic Key Pressure
+    MidiControlChange = 0xB0,     // Control Change
+    MidiProgramChange = 0xC0,     // Program Change
+    MidiChannelAftertouch = 0xD0, // Channel Pressure
+    MidiPitchBend = 0xE0,         // Pitch Bend
+    MidiSystemMessage = 0xF0      // System messages
+} MidiMessageType;
+
+// Structure to store a parsed MIDI message
+typedef struct {
+    uint8_t status;      // Status byte (includes channel)
+    uint8_t data1;       // First data byte
+    uint8_t data2;       // Second data byte (if applicable)
+    uint8_t channel;     // MIDI channel (0-15)
+    MidiMessageType type; // Message type
+    uint32_t timestamp;  // Time received (in ticks)
+} MidiMessage;
+
+#define MIDI_USB_PACKET_SIZE 4 // [Cable/CIN][Status][Data1][Data2]
+#define MIDI_SYSEX_START 0xF0
+#define MIDI_SYSEX_END 0xF7
+
+// SysEx reassembler working on a caller-provided buffer.
+// The buffer receives the complete message including F0 and F7.
+typedef struct {
+    uint8_t* buffer;  // Caller-provided storage
+    size_t capacity;  // Size of buffer in bytes
+    size_t length;    // Bytes received so far (may exceed capacity)
+    uint8_t manufacturer; // First byte after F0 (0x7E/0x7F = universal)
+    bool active;      // Between F0 and F7
+    bool overflow;    // Message was longer than capacity (truncated)
+} MidiSysex;
+
+typedef enum {
+    MidiSysexNone,     // Packet did not belong to a SysEx message
+    MidiSysexPartial,  // SysEx started or continued
+    MidiSysexComplete, // F7 received, buffer holds the whole message
+} MidiSysexResult;
+
+// USB MIDI packet decoder
+typedef struct {
+    MidiSysex sysex;
+    // The last message decoded is a completed SysEx. Its status is 0xF0, but
+    // so is a single F0 byte sent with CIN 0xF: test this, not the status.
+    bool sysex_done;
+} MidiDecoder;
+
+// Per-message callback used by midi_decode_packets_cb()
+typedef void (*MidiMessageCallback)(const MidiMessage* message, void* ctx);
+
+// Extract message type and channel from a status byte
+void midi_parse_status(uint8_t status, MidiMessageType* type, uint8_t* channel);
+
+// Number of bytes (status + data) a USB MIDI packet carries, 0 for reserved CINs
+uint8_t midi_cin_length(uint8_t cin);
+
+void midi_sysex_init(MidiSysex* sysex, uint8_t* buffer, size_t capacity);
+void midi_sysex_reset(MidiSysex* sysex);
+// Feed one 4-byte USB MIDI packet
+MidiSysexResult midi_sysex_feed_packet(MidiSysex* sysex, const uint8_t* packet);
+
+// sysex_buffer may be NULL (capacity 0): SysEx is then only reported, not stored
+// (overflow is set for every message)
+void midi_decoder_init(MidiDecoder* decoder, uint8_t* sysex_buffer, size_t sysex_capacity);
+void midi_decoder_reset(MidiDecoder* decoder);
+
+// Decode a span of USB MIDI packets into a caller-provided array.
+// Returns the number of messages written to out. Decoding stops when out is
+// full or right after a SysEx message completes (reported as a MidiSystemMessage
+// with status 0xF0, data1 = manufacturer ID; decoder->sysex_done is set), so
+// the caller can read the reassembly buffer before it is reused. consumed
+// (optional) receives the number of input bytes processed; call again with
+// the remainder.
+size_t midi_decode_packets(
+    MidiDecoder* decoder,
+    const uint8_t* data,
+    size_t length,
+    uint32_t timestamp,
+    MidiMessage* out,
+    size_t capacity,
+    size_t* consumed);
+
+// Same decoding, but every message is handed to callback. Does not stop after
+// SysEx: during the callback, decoder->sysex_done tells whether the message is
+// a completed one (the buffer is only valid until the callback returns).
+size_t midi_decode_packets_cb(
+    MidiDecoder* decoder,
+    const uint8_t* data,
+    size_t length,
+    uint32_t timestamp,
+    MidiMessageCallback callback,
+    void* ctx);
+
+// Reassembled SysEx of the last MidiSysexComplete (F0 ... F7)
+const uint8_t* midi_decoder_sysex(const MidiDecoder* decoder, size_t* length);
+
+// Current state of all 16 channels as implied by the messages seen so far
+typedef struct {
+    uint32_t notes[16][4];      // Held notes, one bit per note number
+    uint8_t velocity[16][128];  // Last Note On velocity per note
+    uint8_t cc[16][128];        // Last value per controller
+    uint8_t program[16];        // Last program change
+    uint8_t pressure[16];       // Last channel pressure
+    uint16_t pitch_bend[16];    // Last pitch bend (14 bit, 8192 = center)
+} MidiChannelState;
+
+void midi_state_reset(MidiChannelState* state);
+void midi_state_apply(MidiChannelState* state, const MidiMessage* message);
+void midi_state_apply_batch(MidiChannelState* state, const MidiMessage* messages, size_t count);
+bool midi_state_note_is_on(const MidiChannelState* state, uint8_t channel, uint8_t note);
+uint8_t midi_state_notes_held(const MidiChannelState* state, uint8_t channel);
+
+// Convert MIDI note number to string representation (e.g., C4, A#5)
+void midi_note_to_string(uint8_t note, char* buffer, size_t size);
+// Format MIDI message for display
+void midi_format_message(const MidiMessage* msg, char* buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
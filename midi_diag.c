@@ -0,0 +1,135 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_DIAGNOSTICS
+
+#include <storage/storage.h>
+
+#include "midi_app.h"
+
+#define MIDI_DIAG_FLAG_STOP (1 << 0)
+
+static const char* const loop_stage_names[MidiLoopStageCount] = {
+    "Wait", "Lock", "Key", "Midi", "Sysex", "UsbStatus", "Flush", "Redraw"};
+static const char* const render_stage_names[MidiRenderStageCount] = {"Idle", "Lock", "Draw"};
+
+static void midi_diag_name(char* out, const char* name) {
+    strncpy(out, name ? name : "", MIDI_POSTMORTEM_NAME - 1);
+    out[MIDI_POSTMORTEM_NAME - 1] = '\0';
+}
+
+// Snapshot of what the main loop and the GUI were doing, without taking any lock
+static void midi_diag_capture(MidiApp* app, MidiPostMortem* record, uint32_t now) {
+    memset(record, 0, sizeof(MidiPostMortem));
+    record->time = furi_hal_rtc_get_timestamp();
+    record->stalled_ms = midi_watchdog_stall_ms(&app->watchdog, now);
+
+    uint8_t stage = app->loop_stage.stage;
+    record->stage_ms = now - app->loop_stage.since;
+    midi_diag_name(record->stage, stage < MidiLoopStageCount ? loop_stage_names[stage] : "?");
+    stage = app->render_stage.stage;
+    record->render_ms = now - app->render_stage.since;
+    midi_diag_name(record->render, stage < MidiRenderStageCount ? render_stage_names[stage] : "?");
+
+    FuriThreadId owner = furi_mutex_get_owner(app->mutex);
+    if(owner) midi_diag_name(record->owner, furi_thread_get_name(owner));
+
+    record->queue_depth = furi_message_queue_get_count(app->event_queue);
+    record->queue_dropped = app->queue_dropped;
+#if MIDI_FEATURE_RECORDER
+    record->capture_pending = midi_recorder_pending(app->recorder);
+#endif
+}
+
+// May block while the stalled loop itself holds the SD card; the record is in RAM already
+static void midi_diag_save(const MidiPostMortem* record) {
+    uint8_t raw[MIDI_POSTMORTEM_SIZE];
+    midi_postmortem_encode(record, raw);
+    midi_store_save(MIDI_STORE_POSTMORTEM, raw, sizeof(raw));
+}
+
+static int32_t midi_diag_thread(void* context) {
+    MidiApp* app = context;
+
+    while(furi_thread_flags_wait(
+              MIDI_DIAG_FLAG_STOP, FuriFlagWaitAny, furi_ms_to_ticks(MIDI_WATCHDOG_PERIOD_MS)) &
+          FuriFlagError) {
+        uint32_t now = furi_get_tick();
+        uint32_t pending = furi_message_queue_get_count(app->event_queue);
+
+        switch(midi_watchdog_check(&app->watchdog, now, pending)) {
+        case MidiWatchdogStalled: {
+            MidiPostMortem record;
+            midi_diag_capture(app, &record, now);
+            app->postmortem = record;
+            app->postmortem_valid = true;
+            FURI_LOG_W(
+                TAG,
+                "Main loop stalled in %s for %lu ms, lock %s, %lu events waiting",
+                record.stage,
+                (unsigned long)record.stalled_ms,
+                record.owner[0] ? record.owner : "free",
+                (unsigned long)record.queue_depth);
+            midi_diag_save(&record);
+            break;
+        }
+        case MidiWatchdogRecovered:
+            app->postmortem.stalled_ms = midi_watchdog_stall_ms(&app->watchdog, now);
+            app->postmortem.recovered = true;
+            midi_diag_save(&app->postmortem);
+            break;
+        default:
+            break;
+        }
+    }
+    return 0;
+}
+
+void midi_diag_start(MidiApp* app) {
+    uint8_t raw[MIDI_POSTMORTEM_SIZE];
+    size_t length = midi_store_load(MIDI_STORE_POSTMORTEM, raw, sizeof(raw));
+    app->postmortem_valid = midi_postmortem_decode(raw, length, &app->postmortem);
+
+    app->queue_dropped = 0;
+    midi_stage_set(&app->loop_stage, MidiLoopWait, furi_get_tick());
+    midi_stage_set(&app->render_stage, MidiRenderIdle, furi_get_tick());
+    midi_watchdog_init(&app->watchdog, MIDI_WATCHDOG_DEADLINE_MS, furi_get_tick());
+
+    app->watchdog_thread = furi_thread_alloc_ex("MidiWatchdog", 1024, midi_diag_thread, app);
+    furi_thread_start(app->watchdog_thread);
+}
+
+void midi_diag_stop(MidiApp* app) {
+    furi_thread_flags_set(furi_thread_get_id(app->watchdog_thread), MIDI_DIAG_FLAG_STOP);
+    furi_thread_join(app->watchdog_thread);
+    furi_thread_free(app->watchdog_thread);
+
+    uint8_t raw[MIDI_QUEUE_STATS_FILE_SIZE];
+    midi_queue_stats_encode(&app->queue_stats, raw);
+    midi_store_save(MIDI_STORE_QUEUE, raw, sizeof(raw));
+}
+
+void midi_diag_clear(MidiApp* app) {
+    app->postmortem_valid = false;
+    midi_store_remove(MIDI_STORE_POSTMORTEM);
+}
+
+uint32_t midi_diag_queue_length(MidiApp* app) {
+    uint8_t raw[MIDI_QUEUE_STATS_FILE_SIZE];
+    size_t length = midi_store_load(MIDI_STORE_QUEUE, raw, sizeof(raw));
+    midi_queue_stats_init(&app->queue_stats, MIDI_EVENT_QUEUE_SIZE);
+    midi_queue_stats_decode(raw, length, &app->queue_stats);
+
+    // Between sessions nothing is queued yet, so this is where the length may change
+    app->queue_stats.capacity = midi_queue_stats_recommend(
+        &app->queue_stats, MIDI_EVENT_QUEUE_MIN, MIDI_EVENT_QUEUE_MAX);
+    FURI_LOG_I(TAG, "Event queue: %lu events", (unsigned long)app->queue_stats.capacity);
+    return app->queue_stats.capacity;
+}
+
+void midi_diag_queue_clear(MidiApp* app) {
+    midi_queue_stats_init(&app->queue_stats, app->queue_stats.capacity);
+    app->queue_stats.dropped = app->queue_dropped;
+    midi_store_remove(MIDI_STORE_QUEUE);
+}
+
+#endif // MIDI_FEATURE_DIAGNOSTICS
@@ -0,0 +1,277 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_OUTPUT
+
+#include <furi.h>
+#include <furi_hal.h>
+
+#include "midi_din.h"
+
+#define TAG "Mitzi_Midi_Din"
+#define MIDI_DIN_LINK_SEED 0xACE1
+#define MIDI_DIN_TX_WAIT_MS 20 // Worker wake-up to check for the link test and exit
+#define MIDI_DIN_REQUEST_TRIES 50 // 1 ms polls for the worker to take a reset (a chunk is ~10 ms)
+#define MIDI_DIN_FLAG_WAKE (1 << 0) // Bytes or a playout message queued
+#define MIDI_DIN_FLAG_PLAYOUT (1 << 1) // Reset the playout buffer and start it
+#define MIDI_DIN_FLAG_LINK (1 << 2) // Reset the link test and start it
+#define MIDI_DIN_FLAGS (MIDI_DIN_FLAG_WAKE | MIDI_DIN_FLAG_PLAYOUT | MIDI_DIN_FLAG_LINK)
+
+struct MidiDin {
+    FuriHalSerialHandle* serial;
+    FuriThread* tx_thread;        // Sends queued bytes or the test pattern
+    FuriStreamBuffer* tx_stream;  // Bytes from midi_din_send()
+    volatile bool running;        // Worker keeps going until midi_din_free()
+    volatile bool link_running;
+    volatile bool playout_running;
+    volatile bool producing;      // Receive path between midi_din_playout_begin() and _end()
+    uint8_t playout_percentile;   // For the next playout reset
+    volatile uint32_t dropped;    // Bytes that did not fit into tx_stream
+    MidiLinkTest link;            // TX side written by the worker, RX side by the DMA callback,
+                                  // reset by the worker while the RX side is stopped
+    MidiPlayout playout;          // Pushed by the receive path, sent by the worker,
+                                  // reset by the worker only, see midi_din_request()
+};
+
+static uint32_t midi_din_now(void) {
+    return DWT->CYCCNT;
+}
+
+// RX DMA callback (interrupt context): compare what arrived against the pattern
+static void midi_din_rx_callback(
+    FuriHalSerialHandle* handle,
+    FuriHalSerialRxEvent event,
+    size_t data_len,
+    void* context) {
+    MidiDin* din = context;
+    uint32_t now = midi_din_now();
+
+    // Nothing is counted while stopped: the worker may be resetting the statistics
+    bool counting = din->link_running;
+    if(counting && (event & FuriHalSerialRxEventFrameError)) {
+        midi_link_test_error(&din->link, MidiLinkErrorFraming);
+    }
+    if(counting && (event & FuriHalSerialRxEventNoiseError)) {
+        midi_link_test_error(&din->link, MidiLinkErrorNoise);
+    }
+    if(counting && (event & FuriHalSerialRxEventOverrunError)) {
+        midi_link_test_error(&din->link, MidiLinkErrorOverrun);
+    }
+
+    if(event & (FuriHalSerialRxEventData | FuriHalSerialRxEventIdle)) {
+        uint8_t data[MIDI_DIN_LINK_CHUNK];
+        while(data_len > 0) {
+            size_t length = furi_hal_serial_dma_rx(
+                handle, data, data_len < sizeof(data) ? data_len : sizeof(data));
+            if(length == 0) break;
+            if(counting) midi_link_test_rx(&din->link, data, length, now);
+            data_len -= length;
+        }
+    }
+}
+
+static int32_t midi_din_tx_thread(void* context) {
+    MidiDin* din = context;
+    uint8_t chunk[MIDI_DIN_LINK_CHUNK];
+    uint32_t ticks_per_us = furi_hal_cortex_instructions_per_microsecond();
+
+    while(din->running) {
+        // Resets run here, between chunks: never during a pop or a test chunk.
+        // The RX callback and the producer are already masked by the requester.
+        uint32_t flags = furi_thread_flags_clear(MIDI_DIN_FLAGS);
+        if(flags & FuriFlagError) flags = 0;
+        if(flags & MIDI_DIN_FLAG_LINK) {
+            midi_link_test_init(&din->link, MIDI_DIN_LINK_SEED, ticks_per_us);
+            furi_stream_buffer_reset(din->tx_stream);
+            __atomic_store_n(&din->link_running, true, __ATOMIC_RELEASE);
+        }
+        if(flags & MIDI_DIN_FLAG_PLAYOUT) {
+            midi_playout_reset(&din->playout);
+            din->playout.percentile = din->playout_percentile;
+            __atomic_store_n(&din->playout_running, true, __ATOMIC_RELEASE);
+        }
+
+        size_t length;
+        if(din->link_running) {
+            length = sizeof(chunk);
+            midi_link_test_tx(&din->link, chunk, length, midi_din_now());
+        } else {
+            // Due playout messages, then bytes sent straight away
+            length = midi_playout_pop(&din->playout, midi_din_now(), chunk, sizeof(chunk));
+            length += furi_stream_buffer_receive(
+                din->tx_stream, &chunk[length], sizeof(chunk) - length, 0);
+        }
+        if(length > 0) {
+            furi_hal_serial_tx(din->serial, chunk, length);
+            furi_hal_serial_tx_wait_complete(din->serial);
+            continue;
+        }
+
+        // Nothing to send: sleep until the next playout message is due or a sender wakes us
+        uint32_t wait = midi_playout_wait(&din->playout, midi_din_now());
+        uint32_t wait_us = wait == UINT32_MAX ? MIDI_DIN_TX_WAIT_MS * 1000 : wait / ticks_per_us;
+        if(wait_us < 1000) {
+            furi_delay_us(wait_us); // Below the kernel tick
+        } else {
+            uint32_t wait_ms = wait_us / 1000;
+            if(wait_ms > MIDI_DIN_TX_WAIT_MS) wait_ms = MIDI_DIN_TX_WAIT_MS;
+            // Flags are left set for the top of the loop to take
+            furi_thread_flags_wait(
+                MIDI_DIN_FLAGS, FuriFlagWaitAny | FuriFlagNoClear, furi_ms_to_ticks(wait_ms));
+        }
+    }
+    return 0;
+}
+
+MidiDin* midi_din_alloc(void) {
+    FuriHalSerialHandle* serial = furi_hal_serial_control_acquire(FuriHalSerialIdUsart);
+    if(!serial) {
+        FURI_LOG_E(TAG, "USART busy");
+        return NULL;
+    }
+
+    MidiDin* din = malloc(sizeof(MidiDin));
+    memset(din, 0, sizeof(MidiDin));
+    din->serial = serial;
+    din->tx_stream = furi_stream_buffer_alloc(MIDI_DIN_TX_BUFFER, 1);
+    midi_link_test_init(
+        &din->link, MIDI_DIN_LINK_SEED, furi_hal_cortex_instructions_per_microsecond());
+    midi_playout_init(
+        &din->playout, furi_hal_cortex_instructions_per_microsecond(), 95, MIDI_DIN_PLAYOUT_MAX_US);
+
+    furi_hal_serial_init(din->serial, MIDI_LINK_BAUDRATE);
+    furi_hal_serial_dma_rx_start(din->serial, midi_din_rx_callback, din, true);
+
+    din->running = true;
+    din->tx_thread = furi_thread_alloc_ex("MidiDinTx", 1024, midi_din_tx_thread, din);
+    furi_thread_start(din->tx_thread);
+    return din;
+}
+
+void midi_din_free(MidiDin* din) {
+    midi_din_link_test_stop(din);
+    din->running = false;
+    furi_thread_join(din->tx_thread);
+    furi_thread_free(din->tx_thread);
+
+    furi_hal_serial_dma_rx_stop(din->serial);
+    furi_hal_serial_deinit(din->serial);
+    furi_hal_serial_control_release(din->serial);
+    furi_stream_buffer_free(din->tx_stream);
+    free(din);
+}
+
+bool midi_din_send(MidiDin* din, const uint8_t* data, size_t length) {
+    if(din->link_running) return false;
+    // Whole messages only: a partial one would corrupt the running status of the receiver
+    if(furi_stream_buffer_spaces_available(din->tx_stream) < length) {
+        din->dropped += length;
+        return false;
+    }
+    furi_stream_buffer_send(din->tx_stream, data, length, 0);
+    furi_thread_flags_set(furi_thread_get_id(din->tx_thread), MIDI_DIN_FLAG_WAKE);
+    return true;
+}
+
+uint32_t midi_din_dropped(const MidiDin* din) {
+    return din->dropped;
+}
+
+// Hand a reset to the worker and wait until it is done (done set by the worker).
+// A busy worker takes it later; the caller only loses the wait.
+static void midi_din_request(MidiDin* din, uint32_t flag, volatile bool* done) {
+    furi_thread_flags_set(furi_thread_get_id(din->tx_thread), flag);
+    for(size_t i = 0; i < MIDI_DIN_REQUEST_TRIES; i++) {
+        if(__atomic_load_n(done, __ATOMIC_ACQUIRE)) return;
+        furi_delay_ms(1);
+    }
+    FURI_LOG_W(TAG, "Worker busy, reset still pending");
+}
+
+void midi_din_link_test_start(MidiDin* din) {
+    if(din->link_running) return;
+
+    // Stopped, so the RX callback leaves the statistics alone until the worker restarts it
+    midi_din_request(din, MIDI_DIN_FLAG_LINK, &din->link_running);
+    FURI_LOG_I(TAG, "Link test started");
+}
+
+void midi_din_link_test_stop(MidiDin* din) {
+    if(!din->link_running) return;
+
+    din->link_running = false;
+    FURI_LOG_I(
+        TAG,
+        "Link test: %lu sent, %lu errors, %lu lost, %lu framing",
+        din->link.sent,
+        din->link.errors,
+        din->link.lost,
+        din->link.framing_errors);
+}
+
+bool midi_din_link_test_is_running(const MidiDin* din) {
+    return din->link_running;
+}
+
+const MidiLinkTest* midi_din_link_test(const MidiDin* din) {
+    return &din->link;
+}
+
+void midi_din_playout_start(MidiDin* din, uint8_t percentile) {
+    // Mask the producer (see midi_din_playout_begin), then let the worker,
+    // the consumer, reset the buffer
+    __atomic_store_n(&din->playout_running, false, __ATOMIC_SEQ_CST);
+    for(size_t i = 0; i < MIDI_DIN_REQUEST_TRIES; i++) {
+        if(!__atomic_load_n(&din->producing, __ATOMIC_SEQ_CST)) break;
+        furi_delay_ms(1);
+    }
+    din->playout_percentile = percentile;
+    midi_din_request(din, MIDI_DIN_FLAG_PLAYOUT, &din->playout_running);
+    FURI_LOG_I(TAG, "Playout started, p%u", percentile);
+}
+
+void midi_din_playout_stop(MidiDin* din) {
+    if(!din->playout_running) return;
+
+    din->playout_running = false;
+    FURI_LOG_I(
+        TAG,
+        "Playout: %lu scheduled, %lu late, added %lu us avg, residual %lu us avg",
+        din->playout.scheduled,
+        din->playout.late,
+        midi_latency_avg(&din->playout.added_us),
+        midi_latency_avg(&din->playout.residual_us));
+}
+
+bool midi_din_playout_is_running(const MidiDin* din) {
+    return din->playout_running;
+}
+
+MidiPlayout* midi_din_playout(MidiDin* din) {
+    return &din->playout;
+}
+
+bool midi_din_playout_begin(MidiDin* din) {
+    // Pairs with midi_din_playout_start: either it sees producing, or we see it stopped
+    __atomic_store_n(&din->producing, true, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&din->playout_running, __ATOMIC_SEQ_CST)) return true;
+    __atomic_store_n(&din->producing, false, __ATOMIC_RELEASE);
+    return false;
+}
+
+void midi_din_playout_end(MidiDin* din) {
+    __atomic_store_n(&din->producing, false, __ATOMIC_RELEASE);
+}
+
+bool midi_din_schedule(
+    MidiDin* din,
+    const uint8_t* data,
+    size_t length,
+    uint32_t arrival,
+    uint32_t source) {
+    if(din->link_running) return false;
+    if(!midi_playout_push(&din->playout, data, length, arrival, source)) return false;
+    furi_thread_flags_set(furi_thread_get_id(din->tx_thread), MIDI_DIN_FLAG_WAKE);
+    return true;
+}
+
+#endif // MIDI_FEATURE_OUTPUT
@@ -0,0 +1,68 @@
+#pragma once
+
+// DIN MIDI port on the USART (pin 13 TX, pin 14 RX) at 31.25 kbaud
+// (MIDI_FEATURE_OUTPUT).
+//
+// A worker thread owns the TX side: it drains the bytes queued with
+// midi_din_send() (never blocks, safe from the USB receive path) or, while
+// the link test runs, sends the midi_link_test.h pattern instead. Messages
+// queued with midi_din_schedule() wait in a playout buffer (midi_playout.h)
+// and are sent when due; the worker sleeps until then. The test
+// pattern is checked in the RX DMA callback, so a cable from the DIN OUT to
+// the DIN IN circuit (or pin 13 straight to pin 14) measures byte errors,
+// UART errors and latency of the physical link.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "midi_link_test.h"
+#include "midi_playout.h"
+
+#define MIDI_DIN_LINK_CHUNK 32 // Bytes per TX call in the link test (~10 ms on the wire)
+#define MIDI_DIN_TX_BUFFER 256 // Bytes queued for sending (~80 ms at 31.25 kbaud)
+#define MIDI_DIN_PLAYOUT_MAX_US 30000 // Upper bound of the playout delay
+
+typedef struct MidiDin MidiDin;
+
+// Acquires the USART; returns NULL if another app or the CLI holds it
+MidiDin* midi_din_alloc(void);
+void midi_din_free(MidiDin* din);
+
+// Queue bytes for sending, never blocks. All or nothing: a message that does
+// not fit is dropped and counted. Discarded while the link test runs.
+bool midi_din_send(MidiDin* din, const uint8_t* data, size_t length);
+uint32_t midi_din_dropped(const MidiDin* din);
+
+// Start sending the test pattern, resets the statistics. As for the playout,
+// the worker resets them while the RX callback counts nothing.
+void midi_din_link_test_start(MidiDin* din);
+void midi_din_link_test_stop(MidiDin* din);
+bool midi_din_link_test_is_running(const MidiDin* din);
+// Statistics, updated from the RX interrupt: counters may be one chunk apart
+const MidiLinkTest* midi_din_link_test(const MidiDin* din);
+
+// Playout buffer on the thru route: while running, thru messages go through
+// midi_din_schedule() and leave at their source spacing plus an adaptive
+// delay covering the given percentile of the observed transit jitter.
+// (Re)starting waits for the producer to leave midi_din_playout_begin/_end,
+// then the worker resets the buffer between chunks. Returns once it has
+// restarted, or after 50 ms if the worker is stuck (it then starts late).
+void midi_din_playout_start(MidiDin* din, uint8_t percentile);
+// Messages already waiting are still sent
+void midi_din_playout_stop(MidiDin* din);
+bool midi_din_playout_is_running(const MidiDin* din);
+// Producer side (midi_playout_source/transfer) and statistics
+MidiPlayout* midi_din_playout(MidiDin* din);
+// Bracket the producer side of one transfer: begin returns false while the
+// playout is stopped or being reset; only call _end after a true begin.
+bool midi_din_playout_begin(MidiDin* din);
+void midi_din_playout_end(MidiDin* din);
+// Queue a message for sending at its playout time, never blocks. Returns
+// false if the buffer is full or the link test runs.
+bool midi_din_schedule(
+    MidiDin* din,
+    const uint8_t* data,
+    size_t length,
+    uint32_t arrival,
+    uint32_t source);
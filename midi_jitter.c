@@ -0,0 +1,72 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_ANALYZERS
+
+#include "midi_jitter.h"
+
+typedef enum {
+    MidiJitterStepOther,
+    MidiJitterStepUp,   // Last change was +1
+    MidiJitterStepDown, // Last change was -1
+    MidiJitterStepNone, // No value seen yet
+} MidiJitterStep;
+
+#define JITTER_CONTROLS (16 * 128)
+#define JITTER_VALUE(word) ((word) & 0x7F)
+#define JITTER_STEP(word) (((word) >> 7) & 0x03)
+#define JITTER_WORD(score, step, value) (((score) << 9) | ((step) << 7) | (value))
+
+void midi_jitter_reset(MidiJitter* jitter) {
+    uint16_t* control = &jitter->control[0][0];
+    for(size_t i = 0; i < JITTER_CONTROLS; i++) {
+        control[i] = JITTER_WORD(0, MidiJitterStepNone, 0);
+    }
+}
+
+void midi_jitter_apply(MidiJitter* jitter, const MidiMessage* message) {
+    if(message->type != MidiControlChange) return;
+
+    uint16_t* control = &jitter->control[message->channel & 0x0F][message->data1 & 0x7F];
+    uint16_t word = *control;
+    uint8_t value = message->data2 & 0x7F;
+    uint32_t score = word >> 9;
+    uint8_t previous_step = JITTER_STEP(word);
+
+    uint8_t step = MidiJitterStepOther;
+    if(previous_step != MidiJitterStepNone) {
+        int diff = (int)value - (int)JITTER_VALUE(word);
+        if(diff == 1) {
+            step = MidiJitterStepUp;
+        } else if(diff == -1) {
+            step = MidiJitterStepDown;
+        }
+    }
+
+    bool reversal = (step == MidiJitterStepUp && previous_step == MidiJitterStepDown) ||
+                    (step == MidiJitterStepDown && previous_step == MidiJitterStepUp);
+    if(reversal) {
+        score += (MIDI_JITTER_SCORE_MAX - score) >> MIDI_JITTER_WINDOW_SHIFT;
+    } else {
+        score -= score >> MIDI_JITTER_WINDOW_SHIFT;
+    }
+
+    *control = JITTER_WORD(score, step, value);
+}
+
+size_t midi_jitter_next(const MidiJitter* jitter, size_t index) {
+    const uint16_t* control = &jitter->control[0][0];
+    for(; index < JITTER_CONTROLS; index++) {
+        if((control[index] >> 9) >= MIDI_JITTER_THRESHOLD) break;
+    }
+    return index;
+}
+
+size_t midi_jitter_count(const MidiJitter* jitter) {
+    size_t count = 0;
+    for(size_t i = midi_jitter_next(jitter, 0); i < JITTER_CONTROLS; i = midi_jitter_next(jitter, i + 1)) {
+        count++;
+    }
+    return count;
+}
+
+#endif // MIDI_FEATURE_ANALYZERS
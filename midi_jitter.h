@@ -0,0 +1,50 @@
+#pragma once
+
+// Jittery controller detection: a noisy potentiometer sends Control Changes
+// that bounce between two adjacent values (64 65 64 65 ...).
+//
+// For every channel and controller one 16-bit word holds the last value, the
+// direction of the last step (+1, -1, other) and a 7-bit reversal score: an
+// exponential moving average over the last ~8 messages of "this message
+// reversed a ±1 step with a ∓1 step". An update is a few shifts, the whole
+// table is 4 KB.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "midi_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIDI_JITTER_SCORE_MAX 127
+#define MIDI_JITTER_WINDOW_SHIFT 3 // Moving average weight 1/8 (~8 messages)
+#define MIDI_JITTER_THRESHOLD 64   // Score from which a control counts as jittery (~50 % reversals)
+
+typedef struct {
+    // score << 9 | step << 7 | value; step: MidiJitterStep
+    uint16_t control[16][128];
+} MidiJitter;
+
+void midi_jitter_reset(MidiJitter* jitter);
+// Control Changes update the detector, everything else is ignored
+void midi_jitter_apply(MidiJitter* jitter, const MidiMessage* message);
+
+// Reversal score 0..127
+static inline uint8_t midi_jitter_score(const MidiJitter* jitter, uint8_t channel, uint8_t controller) {
+    return jitter->control[channel & 0x0F][controller & 0x7F] >> 9;
+}
+
+static inline bool midi_jitter_is_jittery(const MidiJitter* jitter, uint8_t channel, uint8_t controller) {
+    return midi_jitter_score(jitter, channel, controller) >= MIDI_JITTER_THRESHOLD;
+}
+
+// Next jittery control at or after index (channel * 128 + controller), 2048 if none
+size_t midi_jitter_next(const MidiJitter* jitter, size_t index);
+size_t midi_jitter_count(const MidiJitter* jitter);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,134 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_OUTPUT
+
+#include "midi_link_test.h"
+
+#include <string.h>
+
+void midi_lfsr_init(MidiLfsr* lfsr, uint16_t seed) {
+    lfsr->state = seed ? seed : 0xACE1;
+}
+
+uint8_t midi_lfsr_next(MidiLfsr* lfsr) {
+    uint16_t state = lfsr->state;
+    for(uint8_t i = 0; i < 8; i++) {
+        // Taps 16, 14, 13, 11; the new bit is shifted in at the bottom
+        uint16_t bit = ((state >> 15) ^ (state >> 13) ^ (state >> 12) ^ (state >> 10)) & 1;
+        state = (state << 1) | bit;
+    }
+    lfsr->state = state;
+    return state & 0xFF; // The last 8 bits produced
+}
+
+void midi_link_test_init(MidiLinkTest* test, uint16_t seed, uint32_t ticks_per_us) {
+    memset(test, 0, sizeof(MidiLinkTest));
+    midi_lfsr_init(&test->tx, seed);
+    test->expect = test->tx;
+    test->ticks_per_us = ticks_per_us ? ticks_per_us : 1;
+    test->latency_min_us = UINT32_MAX;
+}
+
+void midi_link_test_tx(MidiLinkTest* test, uint8_t* buf, size_t length, uint32_t now) {
+    uint8_t next = (test->mark_head + 1) % MIDI_LINK_MARKS;
+    if(next != test->mark_tail) {
+        test->marks[test->mark_head].index = test->tx_index;
+        test->marks[test->mark_head].time = now;
+        test->mark_head = next;
+    }
+
+    for(size_t i = 0; i < length; i++) {
+        buf[i] = midi_lfsr_next(&test->tx);
+    }
+    test->tx_index += length;
+    test->sent += length;
+}
+
+// Latency of the chunk starting at the byte just received; marks of skipped bytes are dropped
+static void midi_link_test_latency(MidiLinkTest* test, uint32_t index, uint32_t now) {
+    while(test->mark_tail != test->mark_head) {
+        uint32_t mark = test->marks[test->mark_tail].index;
+        if((int32_t)(mark - index) > 0) break; // Not there yet
+        if(mark == index) {
+            uint32_t latency = (now - test->marks[test->mark_tail].time) / test->ticks_per_us;
+            if(latency < test->latency_min_us) test->latency_min_us = latency;
+            if(latency > test->latency_max_us) test->latency_max_us = latency;
+            test->latency_sum_us += latency;
+            test->latency_count++;
+        }
+        test->mark_tail = (test->mark_tail + 1) % MIDI_LINK_MARKS;
+    }
+}
+
+// The last two bytes are a full LFSR state: look for it a few bytes ahead
+static bool midi_link_test_realign(MidiLinkTest* test, uint16_t state) {
+    MidiLfsr probe = test->expect;
+    for(uint32_t skip = 1; skip <= MIDI_LINK_RESYNC_WINDOW; skip++) {
+        midi_lfsr_next(&probe);
+        if(probe.state == state) {
+            test->expect = probe;
+            test->lost += skip;
+            test->rx_index += skip;
+            // The two bytes that revealed the drop were correct, just shifted
+            test->errors -= 2;
+            return true;
+        }
+    }
+    return false;
+}
+
+void midi_link_test_rx(MidiLinkTest* test, const uint8_t* data, size_t length, uint32_t now) {
+    for(size_t i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+        uint8_t expected = midi_lfsr_next(&test->expect);
+        uint32_t index = test->rx_index++;
+        test->received++;
+
+        if(byte == expected) {
+            test->mismatch_run = 0;
+            midi_link_test_latency(test, index, now);
+        } else {
+            test->errors++;
+            test->mismatch_run++;
+            if(test->mismatch_run >= 2) {
+                uint16_t state = ((uint16_t)test->previous << 8) | byte;
+                if(midi_link_test_realign(test, state)) {
+                    test->mismatch_run = 0;
+                } else if(test->mismatch_run >= MIDI_LINK_RESYNC_HARD) {
+                    // Lost beyond the window: adopt the received stream
+                    test->expect.state = state;
+                    test->resyncs++;
+                    test->mismatch_run = 0;
+                    test->rx_index = test->tx_index; // Best guess, fixes itself on the next mark
+                    test->mark_tail = test->mark_head;
+                }
+            }
+        }
+        test->previous = byte;
+    }
+}
+
+void midi_link_test_error(MidiLinkTest* test, MidiLinkError error) {
+    switch(error) {
+    case MidiLinkErrorFraming:
+        test->framing_errors++;
+        break;
+    case MidiLinkErrorNoise:
+        test->noise_errors++;
+        break;
+    case MidiLinkErrorOverrun:
+        test->overruns++;
+        break;
+    }
+}
+
+uint32_t midi_link_test_error_ppm(const MidiLinkTest* test) {
+    if(test->sent == 0) return 0;
+    return (uint32_t)(((uint64_t)test->errors + test->lost) * 1000000ULL / test->sent);
+}
+
+uint32_t midi_link_test_latency_avg_us(const MidiLinkTest* test) {
+    return test->latency_count ? (uint32_t)(test->latency_sum_us / test->latency_count) : 0;
+}
+
+#endif // MIDI_FEATURE_OUTPUT
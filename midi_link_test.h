@@ -0,0 +1,85 @@
+#pragma once
+
+// Physical link test: a pseudo-random byte stream is sent over the DIN/UART
+// loopback and compared byte by byte on the receive side.
+//
+// The stream is the bit sequence of a 16-bit Fibonacci LFSR
+// (x^16 + x^14 + x^13 + x^11 + 1, period 65535 bytes), so any two
+// consecutive correct bytes are the full generator state. That lets the
+// checker tell corrupted bytes from lost ones and realign after a drop.
+//
+// Times are in caller ticks (DWT cycles on the device, microseconds in the
+// host simulation); ticks_per_us converts latencies.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIDI_LINK_BAUDRATE 31250
+#define MIDI_LINK_MARKS 16          // TX chunks in flight for latency measurement
+#define MIDI_LINK_RESYNC_WINDOW 64  // Dropped bytes recovered without losing alignment
+#define MIDI_LINK_RESYNC_HARD 16    // Consecutive mismatches before realigning blindly
+
+typedef struct {
+    uint16_t state; // Never 0
+} MidiLfsr;
+
+typedef enum {
+    MidiLinkErrorFraming,
+    MidiLinkErrorNoise,
+    MidiLinkErrorOverrun,
+} MidiLinkError;
+
+typedef struct {
+    MidiLfsr tx;      // Generator of the send side
+    MidiLfsr expect;  // Generator the receive side compares against
+    uint32_t ticks_per_us;
+
+    uint32_t sent;           // Bytes generated for sending
+    uint32_t received;       // Bytes received
+    uint32_t errors;         // Received bytes that did not match
+    uint32_t lost;           // Bytes skipped when realigning after a drop
+    uint32_t resyncs;        // Alignment lost beyond the resync window
+    uint32_t framing_errors; // Reported by the UART
+    uint32_t noise_errors;
+    uint32_t overruns;
+
+    uint32_t tx_index;       // Sequence position of the next byte sent
+    uint32_t rx_index;       // Sequence position of the next byte expected
+    uint8_t previous;        // Last received byte
+    uint8_t mismatch_run;    // Consecutive mismatches
+
+    struct {
+        uint32_t index;      // Sequence position of the first byte of a chunk
+        uint32_t time;       // Ticks when it was handed to the UART
+    } marks[MIDI_LINK_MARKS];
+    uint8_t mark_head;
+    uint8_t mark_tail;
+
+    uint32_t latency_min_us;
+    uint32_t latency_max_us;
+    uint64_t latency_sum_us;
+    uint32_t latency_count;
+} MidiLinkTest;
+
+void midi_lfsr_init(MidiLfsr* lfsr, uint16_t seed);
+uint8_t midi_lfsr_next(MidiLfsr* lfsr);
+
+void midi_link_test_init(MidiLinkTest* test, uint16_t seed, uint32_t ticks_per_us);
+// Fill buf with the next bytes to send and remember when they left
+void midi_link_test_tx(MidiLinkTest* test, uint8_t* buf, size_t length, uint32_t now);
+// Compare received bytes (RX DMA path)
+void midi_link_test_rx(MidiLinkTest* test, const uint8_t* data, size_t length, uint32_t now);
+void midi_link_test_error(MidiLinkTest* test, MidiLinkError error);
+
+// Byte errors (corrupted + lost) per million bytes sent so far
+uint32_t midi_link_test_error_ppm(const MidiLinkTest* test);
+uint32_t midi_link_test_latency_avg_us(const MidiLinkTest* test);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,52 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_ANALYZERS
+
+#include "midi_meter.h"
+
+#include <string.h>
+
+void midi_meters_reset(MidiMeters* meters) {
+    memset(meters, 0, sizeof(MidiMeters));
+}
+
+void midi_meters_apply(MidiMeters* meters, const MidiMessage* message) {
+    uint8_t level;
+    switch(message->type) {
+    case MidiNoteOn:
+        if(message->data2 == 0) return; // Note Off
+        level = message->data2;
+        break;
+    case MidiPolyAftertouch:
+        level = message->data2;
+        break;
+    case MidiChannelAftertouch:
+        level = message->data1;
+        break;
+    case MidiControlChange:
+    case MidiProgramChange:
+    case MidiPitchBend:
+        level = MIDI_METER_EVENT_LEVEL;
+        break;
+    default:
+        return;
+    }
+    midi_meters_hit(meters, message->channel, level, message->timestamp);
+}
+
+uint8_t midi_meters_level(const MidiMeters* meters, uint8_t channel, uint32_t now) {
+    uint32_t peak = meters->peak[channel & 0x0F];
+    if(peak == 0) return 0;
+
+    uint32_t elapsed = now - meters->time[channel & 0x0F];
+    uint32_t halvings = elapsed >> MIDI_METER_HALF_LIFE_SHIFT;
+    if(halvings >= 7) return 0; // 127 >> 7
+
+    uint32_t level = peak >> halvings;
+    uint32_t fraction = elapsed & (MIDI_METER_HALF_LIFE - 1);
+    // Linear between the halvings: level * (1 - fraction / (2 * half-life))
+    level -= (level * fraction) >> (MIDI_METER_HALF_LIFE_SHIFT + 1);
+    return level;
+}
+
+#endif // MIDI_FEATURE_ANALYZERS
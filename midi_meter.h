@@ -0,0 +1,51 @@
+#pragma once
+
+// Per-channel activity meters with lazy decay.
+//
+// A hit stores the peak level and the time; nothing is updated between
+// events. The decayed level is computed when it is drawn:
+// the peak is halved every MIDI_METER_HALF_LIFE ticks (a shift) and
+// interpolated linearly within a half-life, which approximates an
+// exponential fall-off. Idle channels cost nothing per frame.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "midi_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIDI_METER_CHANNELS 16
+#define MIDI_METER_HALF_LIFE_SHIFT 7 // 128 ticks (ms on the Flipper) per halving
+#define MIDI_METER_HALF_LIFE (1u << MIDI_METER_HALF_LIFE_SHIFT)
+#define MIDI_METER_EVENT_LEVEL 48    // Level of messages without a velocity or pressure
+#define MIDI_METER_MAX 127
+
+typedef struct {
+    // Tick of the last hit, full width: elapsed time only wraps with the tick
+    // itself (49.7 days at 1 kHz). A narrower packed time would bring an idle
+    // channel back at its old peak once it wrapped.
+    uint32_t time[MIDI_METER_CHANNELS];
+    uint8_t peak[MIDI_METER_CHANNELS];
+} MidiMeters;
+
+void midi_meters_reset(MidiMeters* meters);
+
+// Record activity on a channel (level 0..127)
+static inline void midi_meters_hit(MidiMeters* meters, uint8_t channel, uint8_t level, uint32_t now) {
+    meters->time[channel & 0x0F] = now;
+    meters->peak[channel & 0x0F] = level & 0x7F;
+}
+
+// Note On velocity, pressure value, or MIDI_METER_EVENT_LEVEL; Note Off and system messages are ignored
+void midi_meters_apply(MidiMeters* meters, const MidiMessage* message);
+
+// Decayed level 0..127 at time now
+uint8_t midi_meters_level(const MidiMeters* meters, uint8_t channel, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
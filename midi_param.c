@@ -0,0 +1,234 @@
+#include "midi_config.h"
+#include "midi_param.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define ROLAND_DT1 0x12
+
+// Roland models with 3-byte addresses (GS, SC-55 display, MT-32/D-series); newer ones use 4
+static uint8_t roland_address_size(uint32_t model) {
+    switch(model) {
+    case 0x42:
+    case 0x45:
+    case 0x16:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+static bool is_data(const uint8_t* data, size_t length) {
+    for(size_t i = 0; i < length; i++) {
+        if(data[i] & 0x80) return false;
+    }
+    return true;
+}
+
+static uint32_t pack_address(const uint8_t* data, uint8_t size) {
+    uint32_t address = 0;
+    for(uint8_t i = 0; i < size; i++) {
+        address = (address << 8) | data[i];
+    }
+    return address;
+}
+
+static MidiParamStatus decode_roland(const uint8_t* sysex, size_t length, MidiParamChange* change) {
+    // F0 41 dev model... 12 ...: model IDs are extended by leading zero bytes
+    size_t i = 3;
+    while(i < length && i < 6 && sysex[i] == 0x00) i++;
+    if(i + 1 >= length) return MidiParamMalformed;
+
+    uint32_t model = 0;
+    for(size_t m = 3; m <= i; m++) {
+        model = (model << 8) | sysex[m];
+    }
+    i++;
+    if(sysex[i] != ROLAND_DT1) return MidiParamNotParam;
+    i++;
+
+    uint8_t address_size = roland_address_size(model & 0xFFFFFF);
+    // address, at least one data byte, checksum, F7
+    if(length < i + address_size + 3) return MidiParamMalformed;
+    size_t body = length - 1 - i; // address + data + checksum
+    if(!is_data(&sysex[i], body)) return MidiParamMalformed;
+
+    // Address + data + checksum must add up to 0 (mod 128)
+    uint8_t sum = 0;
+    for(size_t b = 0; b < body; b++) {
+        sum += sysex[i + b];
+    }
+    if(sum & 0x7F) return MidiParamBadChecksum;
+
+    change->manufacturer = MIDI_MANUFACTURER_ROLAND;
+    change->device = sysex[2];
+    change->model = model & 0xFFFFFF;
+    change->address_size = address_size;
+    change->address = pack_address(&sysex[i], address_size);
+    change->data = &sysex[i + address_size];
+    change->length = body - address_size - 1;
+    return MidiParamOk;
+}
+
+static MidiParamStatus decode_yamaha(const uint8_t* sysex, size_t length, MidiParamChange* change) {
+    // F0 43 1n ... F7, other sub-status values are bulk dumps and requests
+    if((sysex[2] & 0xF0) != 0x10) return MidiParamNotParam;
+    size_t payload = length - 4; // Between 1n and F7
+    if(!is_data(&sysex[3], payload)) return MidiParamMalformed;
+
+    change->manufacturer = MIDI_MANUFACTURER_YAMAHA;
+    change->device = sysex[2] & 0x0F;
+    if(payload == 3) {
+        // DX style: group, parameter, value
+        change->model = 0;
+        change->address_size = 2;
+        change->address = pack_address(&sysex[3], 2);
+        change->data = &sysex[5];
+        change->length = 1;
+    } else if(payload >= 5) {
+        // Model ID, 3-byte address, values
+        change->model = sysex[3];
+        change->address_size = 3;
+        change->address = pack_address(&sysex[4], 3);
+        change->data = &sysex[7];
+        change->length = payload - 4;
+    } else {
+        return MidiParamMalformed;
+    }
+    return MidiParamOk;
+}
+
+MidiParamStatus midi_param_decode(const uint8_t* sysex, size_t length, MidiParamChange* change) {
+    if(length < 6 || sysex[0] != 0xF0 || sysex[length - 1] != 0xF7) return MidiParamNotParam;
+
+    switch(sysex[1]) {
+    case MIDI_MANUFACTURER_ROLAND:
+        return decode_roland(sysex, length, change);
+    case MIDI_MANUFACTURER_YAMAHA:
+        return decode_yamaha(sysex, length, change);
+    default:
+        return MidiParamNotParam;
+    }
+}
+
+#if MIDI_FEATURE_ANALYZERS
+
+// The parameter table only backs the Params screen; decoding and formatting
+// stay in the core for the message history.
+
+uint32_t midi_param_address_add(uint32_t address, uint8_t address_size, uint32_t offset) {
+    // Unpack 7-bit digits, add, repack
+    uint32_t linear = 0;
+    for(int8_t i = address_size - 1; i >= 0; i--) {
+        linear = (linear << 7) | ((address >> (8 * i)) & 0x7F);
+    }
+    linear += offset;
+    uint32_t result = 0;
+    for(uint8_t i = 0; i < address_size; i++) {
+        result |= (linear & 0x7F) << (8 * i);
+        linear >>= 7;
+    }
+    return result;
+}
+
+void midi_param_table_init(MidiParamTable* table, MidiParamEntry* entries, size_t capacity) {
+    table->entries = entries;
+    table->capacity = capacity;
+    midi_param_table_clear(table);
+}
+
+void midi_param_table_clear(MidiParamTable* table) {
+    memset(table->entries, 0, table->capacity * sizeof(MidiParamEntry));
+    table->count = 0;
+    table->dropped = 0;
+}
+
+static inline size_t midi_param_slot(const MidiParamTable* table, uint64_t key) {
+    // Fibonacci hashing, upper bits are the best mixed
+    uint64_t hash = key * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(hash >> 32) & (table->capacity - 1);
+}
+
+bool midi_param_table_write(MidiParamTable* table, uint64_t key, uint8_t address_size, uint8_t value) {
+    size_t mask = table->capacity - 1;
+    for(size_t i = midi_param_slot(table, key);; i = (i + 1) & mask) {
+        MidiParamEntry* entry = &table->entries[i];
+        if(entry->key == key) {
+            if(entry->value != value) {
+                entry->value = value;
+                entry->dirty = true;
+            }
+            return true;
+        }
+        if(entry->key == 0) {
+            // Keep a quarter of the slots free so probe chains stay short
+            if((table->count + 1) * 4 > table->capacity * 3) {
+                table->dropped++;
+                return false;
+            }
+            entry->key = key;
+            entry->value = value;
+            entry->address_size = address_size;
+            entry->dirty = true;
+            table->count++;
+            return true;
+        }
+    }
+}
+
+const MidiParamEntry* midi_param_table_find(const MidiParamTable* table, uint64_t key) {
+    size_t mask = table->capacity - 1;
+    for(size_t i = midi_param_slot(table, key);; i = (i + 1) & mask) {
+        const MidiParamEntry* entry = &table->entries[i];
+        if(entry->key == key) return entry;
+        if(entry->key == 0) return NULL;
+    }
+}
+
+size_t midi_param_table_apply(MidiParamTable* table, const MidiParamChange* change) {
+    size_t stored = 0;
+    for(size_t i = 0; i < change->length; i++) {
+        uint32_t address = midi_param_address_add(change->address, change->address_size, i);
+        uint64_t key = midi_param_key(change->manufacturer, change->model, address);
+        if(midi_param_table_write(table, key, change->address_size, change->data[i])) stored++;
+    }
+    return stored;
+}
+
+size_t midi_param_table_next_dirty(const MidiParamTable* table, size_t start) {
+    for(size_t i = start; i < table->capacity; i++) {
+        if(table->entries[i].key && table->entries[i].dirty) return i;
+    }
+    return table->capacity;
+}
+
+size_t midi_param_table_dirty_count(const MidiParamTable* table) {
+    size_t count = 0;
+    for(size_t i = 0; i < table->capacity; i++) {
+        if(table->entries[i].key && table->entries[i].dirty) count++;
+    }
+    return count;
+}
+
+void midi_param_table_clear_dirty(MidiParamTable* table) {
+    for(size_t i = 0; i < table->capacity; i++) {
+        table->entries[i].dirty = false;
+    }
+}
+
+#endif // MIDI_FEATURE_ANALYZERS
+
+void midi_param_write_from_change(const MidiParamChange* change, MidiParamWrite* write) {
+    write->manufacturer = change->manufacturer;
+    write->address_size = change->address_size;
+    write->address = change->address;
+    write->value = change->length ? change->data[0] : 0;
+    write->count = change->length > 255 ? 255 : (uint8_t)change->length;
+}
+
+void midi_param_format(uint8_t manufacturer, uint32_t address, uint8_t address_size, uint8_t value, char* buffer, size_t size) {
+    const char* name = (manufacturer == MIDI_MANUFACTURER_ROLAND) ? "Roland" :
+                       (manufacturer == MIDI_MANUFACTURER_YAMAHA) ? "Yamaha" :
+                                                                    "SysEx";
+    snprintf(buffer, size, "%s 0x%0*lX = %u", name, address_size * 2, (unsigned long)address, value);
+}
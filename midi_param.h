@@ -0,0 +1,99 @@
+#pragma once
+
+// Parameter-change SysEx (Roland DT1, Yamaha parameter change) decoded into
+// address/value writes, and a sparse parameter table keyed by address.
+//
+// Roland DT1:  F0 41 dev model... 12 addr(3-4) data... checksum F7
+// Yamaha:      F0 43 1n model addr(3) data... F7   (XG, MU, ...)
+//              F0 43 1n group param data F7          (DX style)
+//
+// The table is an open-addressing hash (linear probing) over a caller-provided
+// power-of-two array. It never grows: once 3/4 full, new addresses are dropped
+// and counted, existing ones keep updating.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIDI_MANUFACTURER_ROLAND 0x41
+#define MIDI_MANUFACTURER_YAMAHA 0x43
+
+typedef enum {
+    MidiParamOk,
+    MidiParamNotParam,    // Some other SysEx
+    MidiParamBadChecksum, // Roland checksum mismatch
+    MidiParamMalformed,   // Too short or data byte >= 0x80
+} MidiParamStatus;
+
+// One decoded parameter-change message, data points into the SysEx buffer
+typedef struct {
+    uint8_t manufacturer; // MIDI_MANUFACTURER_*
+    uint8_t device;       // Roland device ID / Yamaha device number (n of 1n)
+    uint32_t model;       // Model ID (last 3 bytes)
+    uint32_t address;     // Address bytes packed big endian, e.g. 0x01000203
+    uint8_t address_size; // 2 to 4 bytes
+    const uint8_t* data;  // Values for address, address + 1, ...
+    size_t length;
+} MidiParamChange;
+
+// Single address/value write, e.g. for the history
+typedef struct {
+    uint8_t manufacturer;
+    uint8_t address_size;
+    uint8_t value;
+    uint8_t count; // Number of bytes in the message (>1: consecutive addresses)
+    uint32_t address;
+} MidiParamWrite;
+
+typedef struct {
+    uint64_t key;         // midi_param_key(), 0 = empty slot
+    uint8_t value;
+    uint8_t address_size;
+    bool dirty;           // Changed since midi_param_table_clear_dirty()
+} MidiParamEntry;
+
+typedef struct {
+    MidiParamEntry* entries;
+    size_t capacity; // Power of two
+    size_t count;
+    uint32_t dropped; // Writes rejected because the table was full
+} MidiParamTable;
+
+MidiParamStatus midi_param_decode(const uint8_t* sysex, size_t length, MidiParamChange* change);
+
+// Address of the n-th data byte (7 bits per address byte, with carry)
+uint32_t midi_param_address_add(uint32_t address, uint8_t address_size, uint32_t offset);
+
+static inline uint64_t midi_param_key(uint8_t manufacturer, uint32_t model, uint32_t address) {
+    return ((uint64_t)manufacturer << 56) | ((uint64_t)(model & 0xFFFFFF) << 32) | address;
+}
+static inline uint8_t midi_param_key_manufacturer(uint64_t key) {
+    return key >> 56;
+}
+static inline uint32_t midi_param_key_address(uint64_t key) {
+    return (uint32_t)key;
+}
+
+void midi_param_table_init(MidiParamTable* table, MidiParamEntry* entries, size_t capacity);
+void midi_param_table_clear(MidiParamTable* table);
+// Returns false if the address is new and the table is full
+bool midi_param_table_write(MidiParamTable* table, uint64_t key, uint8_t address_size, uint8_t value);
+const MidiParamEntry* midi_param_table_find(const MidiParamTable* table, uint64_t key);
+// Write every byte of change, returns the number of bytes stored
+size_t midi_param_table_apply(MidiParamTable* table, const MidiParamChange* change);
+// Index of the next dirty entry at or after start, capacity if none
+size_t midi_param_table_next_dirty(const MidiParamTable* table, size_t start);
+size_t midi_param_table_dirty_count(const MidiParamTable* table);
+void midi_param_table_clear_dirty(MidiParamTable* table);
+
+void midi_param_write_from_change(const MidiParamChange* change, MidiParamWrite* write);
+// "Roland 0x01000203 = 42"
+void midi_param_format(uint8_t manufacturer, uint32_t address, uint8_t address_size, uint8_t value, char* buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
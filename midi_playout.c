@@ -0,0 +1,153 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_OUTPUT
+
+#include "midi_playout.h"
+
+#include <string.h>
+
+void midi_playout_init(
+    MidiPlayout* playout,
+    uint32_t ticks_per_us,
+    uint8_t percentile,
+    uint32_t max_latency_us) {
+    memset(playout, 0, sizeof(MidiPlayout));
+    playout->ticks_per_us = ticks_per_us ? ticks_per_us : 1;
+    playout->percentile = percentile;
+    playout->max_latency = max_latency_us * playout->ticks_per_us;
+    midi_playout_reset(playout);
+}
+
+void midi_playout_reset(MidiPlayout* playout) {
+    memset(playout->histogram, 0, sizeof(playout->histogram));
+    playout->samples = 0;
+    playout->have_transit = false;
+    playout->target = 0;
+    playout->have_arrival = false;
+    playout->scheduled = 0;
+    playout->late = 0;
+    playout->overflow = 0;
+    midi_latency_reset(&playout->added_us);
+    midi_latency_reset(&playout->residual_us);
+}
+
+uint32_t midi_playout_source(const MidiPlayout* playout, uint32_t arrival, size_t index, size_t count) {
+    uint32_t gap = arrival - playout->last_arrival;
+    if(!playout->have_arrival || count < 2 || gap > playout->max_latency) return arrival;
+    // Busy link: the clump was produced since the previous transfer
+    return arrival - gap + (uint32_t)((uint64_t)gap * (index + 1) / count);
+}
+
+void midi_playout_transfer(MidiPlayout* playout, uint32_t arrival) {
+    playout->last_arrival = arrival;
+    playout->have_arrival = true;
+}
+
+// Percentile of the histogram as a target latency in ticks
+static void midi_playout_update_target(MidiPlayout* playout) {
+    uint32_t total = 0;
+    for(size_t i = 0; i < MIDI_PLAYOUT_BINS; i++) {
+        total += playout->histogram[i];
+    }
+    uint32_t threshold = total * playout->percentile / 100;
+    uint32_t sum = 0;
+    size_t bin = 0;
+    while(bin < MIDI_PLAYOUT_BINS - 1 && (sum += playout->histogram[bin]) < threshold) {
+        bin++;
+    }
+
+    // Upper edge of the bin
+    uint32_t target = (bin + 1) * MIDI_PLAYOUT_BIN_US * playout->ticks_per_us;
+    playout->target = target < playout->max_latency ? target : playout->max_latency;
+}
+
+static void midi_playout_observe(MidiPlayout* playout, int32_t transit) {
+    if(!playout->have_transit) {
+        playout->window_min = transit;
+        playout->previous_min = transit;
+        playout->have_transit = true;
+    }
+    if(transit < playout->window_min) playout->window_min = transit;
+    playout->transit_min = playout->window_min < playout->previous_min ? playout->window_min :
+                                                                         playout->previous_min;
+
+    uint32_t jitter = (uint32_t)(transit - playout->transit_min) / playout->ticks_per_us /
+                      MIDI_PLAYOUT_BIN_US;
+    playout->histogram[jitter < MIDI_PLAYOUT_BINS ? jitter : MIDI_PLAYOUT_BINS - 1]++;
+
+    playout->samples++;
+    if(playout->samples % MIDI_PLAYOUT_UPDATE == 0) midi_playout_update_target(playout);
+    if(playout->samples >= MIDI_PLAYOUT_WINDOW) {
+        // Older samples count half; the minimum follows clock drift one window behind
+        for(size_t i = 0; i < MIDI_PLAYOUT_BINS; i++) {
+            playout->histogram[i] >>= 1;
+        }
+        playout->previous_min = playout->window_min;
+        playout->window_min = transit;
+        playout->samples = 0;
+    }
+}
+
+bool midi_playout_push(
+    MidiPlayout* playout,
+    const uint8_t* data,
+    size_t length,
+    uint32_t arrival,
+    uint32_t source) {
+    midi_playout_observe(playout, (int32_t)(arrival - source));
+
+    uint32_t head = playout->head;
+    if(head - __atomic_load_n(&playout->tail, __ATOMIC_ACQUIRE) >= MIDI_PLAYOUT_SIZE) {
+        playout->overflow++;
+        return false;
+    }
+
+    uint32_t ideal = source + playout->transit_min + playout->target;
+    uint32_t due = ideal;
+    if((int32_t)(due - arrival) < 0) {
+        due = arrival;
+        playout->late++;
+    }
+    // Never overtake a message queued earlier
+    if(playout->have_due && (int32_t)(due - playout->last_due) < 0) due = playout->last_due;
+    playout->last_due = due;
+    playout->have_due = true;
+
+    MidiPlayoutItem* item = &playout->items[head & (MIDI_PLAYOUT_SIZE - 1)];
+    item->due = due;
+    item->ideal = ideal;
+    item->arrival = arrival;
+    item->length = length < MIDI_PLAYOUT_MAX_BYTES ? length : MIDI_PLAYOUT_MAX_BYTES;
+    memcpy(item->data, data, item->length);
+    playout->scheduled++;
+    __atomic_store_n(&playout->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+uint32_t midi_playout_wait(const MidiPlayout* playout, uint32_t now) {
+    uint32_t tail = playout->tail;
+    if(tail == __atomic_load_n(&playout->head, __ATOMIC_ACQUIRE)) return UINT32_MAX;
+    int32_t wait = (int32_t)(playout->items[tail & (MIDI_PLAYOUT_SIZE - 1)].due - now);
+    return wait > 0 ? (uint32_t)wait : 0;
+}
+
+size_t midi_playout_pop(MidiPlayout* playout, uint32_t now, uint8_t* out, size_t size) {
+    uint32_t head = __atomic_load_n(&playout->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = playout->tail;
+    size_t length = 0;
+
+    while(tail != head) {
+        const MidiPlayoutItem* item = &playout->items[tail & (MIDI_PLAYOUT_SIZE - 1)];
+        if((int32_t)(item->due - now) > 0 || length + item->length > size) break;
+        memcpy(&out[length], item->data, item->length);
+        length += item->length;
+        midi_latency_add(&playout->added_us, (now - item->arrival) / playout->ticks_per_us);
+        midi_latency_add(&playout->residual_us, (now - item->ideal) / playout->ticks_per_us);
+        tail++;
+    }
+
+    __atomic_store_n(&playout->tail, tail, __ATOMIC_RELEASE);
+    return length;
+}
+
+#endif // MIDI_FEATURE_OUTPUT
@@ -0,0 +1,109 @@
+#pragma once
+
+// Playout (dejitter) buffer for the thru route: BLE and busy USB links
+// deliver MIDI in clumps, and forwarding a clump to DIN as it arrives smears
+// the timing. Messages are held back by an adaptive target latency and sent
+// at the spacing of their source times instead.
+//
+// The target latency follows the observed transit jitter: for every message
+// the delay beyond the smallest recent transit time (arrival - source) goes
+// into a decaying histogram, and the target is the configured percentile of
+// it. A message is due at source + smallest transit + target; one that
+// arrives later than that is sent at once and counted as late.
+//
+// Transports with sender timestamps (BLE MIDI) pass them as source times.
+// USB MIDI has none: midi_playout_source() spreads the messages of a transfer
+// evenly over the gap since the previous one, but only while the link is busy
+// (gap up to the maximum latency), so chords after a pause stay together.
+//
+// One producer (receive path) and one consumer (the thread that sends) may
+// run concurrently. Times are caller ticks (DWT cycles on the device,
+// microseconds in the host simulation), statistics are in microseconds.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "midi_profile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIDI_PLAYOUT_SIZE 64       // Messages waiting (power of two)
+#define MIDI_PLAYOUT_MAX_BYTES 3   // Longest message (MIDI_THRU_MAX_BYTES)
+#define MIDI_PLAYOUT_BINS 64       // Jitter histogram bins
+#define MIDI_PLAYOUT_BIN_US 500    // Bin width, the histogram covers 32 ms
+#define MIDI_PLAYOUT_WINDOW 256    // Messages per histogram decay and minimum window
+#define MIDI_PLAYOUT_UPDATE 16     // Messages between target latency updates
+
+typedef struct {
+    uint32_t due;     // Ticks: when to send
+    uint32_t ideal;   // Source time plus the playout delay, before the late/order clamps
+    uint32_t arrival;
+    uint8_t length;
+    uint8_t data[MIDI_PLAYOUT_MAX_BYTES];
+} MidiPlayoutItem;
+
+typedef struct {
+    uint32_t ticks_per_us;
+    uint32_t max_latency;   // Ticks, upper bound of the target latency
+    uint8_t percentile;     // Share of the transit jitter the target latency covers
+
+    // Jitter estimate (producer)
+    uint16_t histogram[MIDI_PLAYOUT_BINS];
+    uint32_t samples;       // Since the last decay
+    int32_t transit_min;    // Smallest transit of this and the previous window
+    int32_t window_min;     // Smallest transit of this window
+    int32_t previous_min;
+    bool have_transit;
+    uint32_t target;        // Ticks
+    uint32_t last_arrival;  // Previous transfer, for midi_playout_source()
+    bool have_arrival;
+    uint32_t last_due;
+    bool have_due;
+
+    MidiPlayoutItem items[MIDI_PLAYOUT_SIZE];
+    uint32_t head;          // Items pushed
+    uint32_t tail;          // Items sent
+
+    uint32_t scheduled;     // Messages pushed
+    uint32_t late;          // Arrived after their playout time
+    uint32_t overflow;      // Dropped, buffer full
+    MidiLatency added_us;   // Arrival to send (consumer)
+    MidiLatency residual_us; // Send time minus ideal playout time (consumer)
+} MidiPlayout;
+
+void midi_playout_init(
+    MidiPlayout* playout,
+    uint32_t ticks_per_us,
+    uint8_t percentile,
+    uint32_t max_latency_us);
+// Forget the jitter estimate and statistics; waiting messages stay queued
+void midi_playout_reset(MidiPlayout* playout);
+
+// Estimated source time of message index out of count in a transfer without
+// sender timestamps; call midi_playout_transfer() once the transfer is done
+uint32_t midi_playout_source(const MidiPlayout* playout, uint32_t arrival, size_t index, size_t count);
+void midi_playout_transfer(MidiPlayout* playout, uint32_t arrival);
+
+// Producer: queue a message, returns false if the buffer is full
+bool midi_playout_push(
+    MidiPlayout* playout,
+    const uint8_t* data,
+    size_t length,
+    uint32_t arrival,
+    uint32_t source);
+
+// Consumer: ticks until the next message is due (0 = now), UINT32_MAX if empty
+uint32_t midi_playout_wait(const MidiPlayout* playout, uint32_t now);
+// Consumer: copy the messages due at now into out, returns the number of bytes
+size_t midi_playout_pop(MidiPlayout* playout, uint32_t now, uint8_t* out, size_t size);
+
+static inline uint32_t midi_playout_target_us(const MidiPlayout* playout) {
+    return playout->target / playout->ticks_per_us;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,26 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_VIEWS || MIDI_FEATURE_OUTPUT || MIDI_FEATURE_DIAGNOSTICS
+
+#include "midi_profile.h"
+
+#include <string.h>
+
+void midi_latency_reset(MidiLatency* latency) {
+    memset(latency, 0, sizeof(MidiLatency));
+    latency->min = UINT32_MAX;
+}
+
+void midi_latency_add(MidiLatency* latency, uint32_t value) {
+    latency->count++;
+    latency->last = value;
+    if(value < latency->min) latency->min = value;
+    if(value > latency->max) latency->max = value;
+    latency->sum += value;
+}
+
+uint32_t midi_latency_avg(const MidiLatency* latency) {
+    return latency->count ? (uint32_t)(latency->sum / latency->count) : 0;
+}
+
+#endif // MIDI_FEATURE_VIEWS || MIDI_FEATURE_OUTPUT || MIDI_FEATURE_DIAGNOSTICS
@@ -0,0 +1,42 @@
+#pragma once
+
+// Latency statistics for the hot paths and stage markers for the loops.
+// Values are in whatever unit the caller measures (microseconds on the
+// device).
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t count;
+    uint32_t last;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} MidiLatency;
+
+// Stage a loop is in and since when, for post-mortems. Written by the loop,
+// read by a watchdog without locks (two volatile words, a torn read only
+// mixes up the time of a stage change).
+typedef struct {
+    volatile uint8_t stage;
+    volatile uint32_t since;
+} MidiStage;
+
+static inline void midi_stage_set(MidiStage* stage, uint8_t value, uint32_t now) {
+    stage->since = now;
+    stage->stage = value;
+}
+
+void midi_latency_reset(MidiLatency* latency);
+void midi_latency_add(MidiLatency* latency, uint32_t value);
+uint32_t midi_latency_avg(const MidiLatency* latency);
+
+#ifdef __cplusplus
+}
+#endif
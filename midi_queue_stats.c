@@ -0,0 +1,113 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_DIAGNOSTICS
+
+#include "midi_queue_stats.h"
+
+#include <string.h>
+
+static inline void put_le16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static inline uint16_t get_le16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+void midi_queue_stats_init(MidiQueueStats* stats, uint32_t capacity) {
+    memset(stats, 0, sizeof(MidiQueueStats));
+    stats->capacity = capacity;
+    midi_queue_stats_reset(stats);
+}
+
+void midi_queue_stats_reset(MidiQueueStats* stats) {
+    stats->in_burst = false;
+    stats->bursts = 0;
+    stats->high_water = 0;
+    midi_latency_reset(&stats->drain);
+    midi_latency_reset(&stats->gap);
+}
+
+void midi_queue_stats_take(MidiQueueStats* stats, uint32_t depth, uint32_t now, uint32_t tick) {
+    if(!stats->in_burst) {
+        stats->in_burst = true;
+        stats->burst_start = now;
+        stats->burst_peak = 0;
+        if(stats->bursts > 0) midi_latency_add(&stats->gap, tick - stats->idle_since);
+    }
+    if(depth > stats->burst_peak) stats->burst_peak = depth;
+}
+
+void midi_queue_stats_idle(MidiQueueStats* stats, uint32_t dropped, uint32_t now, uint32_t tick) {
+    if(!stats->in_burst) {
+        stats->dropped = dropped; // Lost before the first take count for the next burst
+        return;
+    }
+    stats->in_burst = false;
+    stats->idle_since = tick;
+    stats->bursts++;
+    midi_latency_add(&stats->drain, now - stats->burst_start);
+
+    uint32_t demand = stats->burst_peak + (dropped - stats->dropped);
+    stats->dropped = dropped;
+    if(demand > stats->high_water) stats->high_water = demand;
+
+    size_t bin = demand > MIDI_QUEUE_STATS_DEPTHS ? MIDI_QUEUE_STATS_DEPTHS - 1 : demand - 1;
+    if(stats->demand[bin] == UINT16_MAX) {
+        for(size_t i = 0; i < MIDI_QUEUE_STATS_DEPTHS; i++) stats->demand[i] >>= 1;
+    }
+    stats->demand[bin]++;
+}
+
+uint32_t midi_queue_stats_recommend(const MidiQueueStats* stats, uint32_t min, uint32_t max) {
+    // Events of all bursts, bin i holds bursts of demand i + 1
+    uint64_t events = 0;
+    for(size_t i = 0; i < MIDI_QUEUE_STATS_DEPTHS; i++) events += (uint64_t)stats->demand[i] * (i + 1);
+
+    uint32_t length = stats->capacity;
+    if(events > 0) {
+        uint32_t depth = 1;
+        for(; depth < MIDI_QUEUE_STATS_DEPTHS; depth++) {
+            // Events a queue of this length would have lost
+            uint64_t lost = 0;
+            for(size_t i = depth; i < MIDI_QUEUE_STATS_DEPTHS; i++) {
+                lost += (uint64_t)stats->demand[i] * (i + 1 - depth);
+            }
+            if(lost * MIDI_QUEUE_STATS_MISS <= events) break;
+        }
+        length = depth + depth / 4;
+        length = (length + 3) & ~3u;
+    }
+    if(length < min) length = min;
+    if(length > max) length = max;
+    return length;
+}
+
+void midi_queue_stats_encode(const MidiQueueStats* stats, uint8_t* out) {
+    memcpy(out, MIDI_QUEUE_STATS_MAGIC, 4);
+    put_le16(&out[4], MIDI_QUEUE_STATS_VERSION);
+    put_le16(&out[6], MIDI_QUEUE_STATS_FILE_SIZE);
+    for(size_t i = 0; i < MIDI_QUEUE_STATS_DEPTHS; i++) {
+        put_le16(&out[8 + 2 * i], stats->demand[i]);
+    }
+}
+
+bool midi_queue_stats_decode(const uint8_t* data, size_t length, MidiQueueStats* stats) {
+    if(length < MIDI_QUEUE_STATS_FILE_SIZE) return false;
+    if(memcmp(data, MIDI_QUEUE_STATS_MAGIC, 4) != 0) return false;
+    if(get_le16(&data[4]) != MIDI_QUEUE_STATS_VERSION) return false;
+    if(get_le16(&data[6]) != MIDI_QUEUE_STATS_FILE_SIZE) return false;
+
+    uint32_t total = 0;
+    for(size_t i = 0; i < MIDI_QUEUE_STATS_DEPTHS; i++) {
+        stats->demand[i] = get_le16(&data[8 + 2 * i]);
+        total += stats->demand[i];
+    }
+    if(total > MIDI_QUEUE_STATS_KEEP) {
+        for(size_t i = 0; i < MIDI_QUEUE_STATS_DEPTHS; i++) stats->demand[i] >>= 1;
+    }
+    return true;
+}
+
+#endif // MIDI_FEATURE_DIAGNOSTICS
@@ -0,0 +1,74 @@
+#pragma once
+
+// Event queue sizing: burst statistics of a queue with a single consumer and
+// a recommended queue length. Fed by the consumer only: the depth before a
+// take is the peak since the previous take, as nothing else removes events.
+// A burst lasts from the first take after the queue ran empty until it is
+// empty again; its demand is the peak depth plus the events lost to a full
+// queue meanwhile, i.e. the length that would have held the whole burst.
+// The recommendation is weighted by events, not bursts: the many one-event
+// bursts of normal playing must not outvote a rare SysEx dump.
+//
+// Drain times use a fine clock that may wrap within a minute (DWT cycles on
+// the device), gaps between bursts the millisecond kernel tick.
+//
+// The demand histogram is kept across sessions (file, little endian):
+// "MQST" | version u16 | size u16 | MIDI_QUEUE_STATS_DEPTHS x u16 counts.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "midi_profile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIDI_QUEUE_STATS_MAGIC "MQST"
+#define MIDI_QUEUE_STATS_VERSION 1
+#define MIDI_QUEUE_STATS_DEPTHS 64 // Histogram range, the last bin holds deeper bursts
+#define MIDI_QUEUE_STATS_MISS 1000 // Recommended length may lose 1 in this many events
+#define MIDI_QUEUE_STATS_KEEP 4000 // Bursts on record before older sessions are halved
+#define MIDI_QUEUE_STATS_FILE_SIZE (8 + 2 * MIDI_QUEUE_STATS_DEPTHS)
+
+typedef struct {
+    uint32_t capacity;     // Queue length in use
+    bool in_burst;
+    uint32_t burst_start;  // Fine clock at the first take
+    uint32_t burst_peak;   // Deepest the queue got in this burst
+    uint32_t dropped;      // Drop counter when the queue last ran empty
+    uint32_t idle_since;   // Tick (ms) the queue last ran empty
+    uint32_t bursts;       // Session
+    uint32_t high_water;   // Largest demand of the session
+    MidiLatency drain;     // First take to empty queue, per burst (fine clock)
+    MidiLatency gap;       // Empty queue to the next burst (ms)
+    uint16_t demand[MIDI_QUEUE_STATS_DEPTHS]; // Bursts by demand - 1, all sessions
+} MidiQueueStats;
+
+void midi_queue_stats_init(MidiQueueStats* stats, uint32_t capacity);
+// Session counters only, the demand histogram is kept
+void midi_queue_stats_reset(MidiQueueStats* stats);
+
+// After each take, depth is the queue length before it. now is the fine
+// clock, tick the kernel tick in ms.
+void midi_queue_stats_take(MidiQueueStats* stats, uint32_t depth, uint32_t now, uint32_t tick);
+// When the consumer finds the queue empty, ends the burst. dropped is the
+// running count of events the producer could not queue.
+void midi_queue_stats_idle(MidiQueueStats* stats, uint32_t dropped, uint32_t now, uint32_t tick);
+
+// Shortest length that would have lost at most 1 in MIDI_QUEUE_STATS_MISS of
+// the events of all bursts seen (a burst of demand d loses d - length), plus
+// a quarter for headroom, rounded up to 4 and clamped to [min, max].
+// Without any bursts seen: the current capacity, clamped.
+uint32_t midi_queue_stats_recommend(const MidiQueueStats* stats, uint32_t min, uint32_t max);
+
+void midi_queue_stats_encode(const MidiQueueStats* stats, uint8_t* out);
+// Loads the histogram, halved if it holds more than MIDI_QUEUE_STATS_KEEP
+// bursts so that recent sessions weigh more. Returns false if magic, version
+// or size do not match.
+bool midi_queue_stats_decode(const uint8_t* data, size_t length, MidiQueueStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
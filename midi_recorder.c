@@ -0,0 +1,163 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_RECORDER
+
+#include <furi.h>
+#include <furi_hal.h>
+#include <storage/storage.h>
+
+#include "midi_recorder.h"
+#include "midi_capture.h"
+
+#define TAG "Mitzi_Midi_Rec"
+#define MIDI_RECORDER_CHUNK (64 * MIDI_CAPTURE_RECORD_SIZE) // Bytes per SD write
+#define MIDI_RECORDER_FILES 1000 // capture_000 to capture_999
+
+struct MidiRecorder {
+    FuriStreamBuffer* stream;  // Records waiting for the SD write
+    Storage* storage;
+    File* file;
+    FuriString* path;          // Current or last capture file
+    bool active;
+    volatile uint32_t records; // Records written to SD
+    volatile uint32_t dropped; // Records lost because the stream buffer was full
+    uint8_t chunk[MIDI_RECORDER_CHUNK];
+};
+
+MidiRecorder* midi_recorder_alloc(void) {
+    MidiRecorder* recorder = malloc(sizeof(MidiRecorder));
+    memset(recorder, 0, sizeof(MidiRecorder));
+    recorder->stream = furi_stream_buffer_alloc(
+        MIDI_RECORDER_BUFFER_RECORDS * MIDI_CAPTURE_RECORD_SIZE, MIDI_CAPTURE_RECORD_SIZE);
+    recorder->storage = furi_record_open(RECORD_STORAGE);
+    recorder->file = storage_file_alloc(recorder->storage);
+    recorder->path = furi_string_alloc();
+    return recorder;
+}
+
+void midi_recorder_free(MidiRecorder* recorder) {
+    midi_recorder_stop(recorder);
+    storage_file_free(recorder->file);
+    furi_string_free(recorder->path);
+    furi_record_close(RECORD_STORAGE);
+    furi_stream_buffer_free(recorder->stream);
+    free(recorder);
+}
+
+// First free capture_NNN.mcap; zero-padded so that the names sort by number
+// (storage_get_next_filename() would give capture, capture1, ...)
+static bool midi_recorder_next_path(MidiRecorder* recorder) {
+    for(uint32_t i = 0; i < MIDI_RECORDER_FILES; i++) {
+        furi_string_printf(
+            recorder->path,
+            "%s/capture_%03lu%s",
+            MIDI_RECORDER_DIR,
+            (unsigned long)i,
+            MIDI_CAPTURE_EXTENSION);
+        if(!storage_file_exists(recorder->storage, furi_string_get_cstr(recorder->path))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool midi_recorder_start(MidiRecorder* recorder) {
+    if(recorder->active) return true;
+
+    storage_simply_mkdir(recorder->storage, MIDI_RECORDER_DIR);
+    FuriString* path = recorder->path;
+    if(!midi_recorder_next_path(recorder)) {
+        FURI_LOG_E(TAG, "No free capture name in %s", MIDI_RECORDER_DIR);
+        return false;
+    }
+
+    bool ok = storage_file_open(
+        recorder->file, furi_string_get_cstr(path), FSAM_WRITE, FSOM_CREATE_ALWAYS);
+    if(ok) {
+        MidiCaptureHeader header = {
+            .version = MIDI_CAPTURE_VERSION,
+            .record_size = MIDI_CAPTURE_RECORD_SIZE,
+            .tick_hz = furi_kernel_get_tick_frequency(),
+            .start_time = furi_hal_rtc_get_timestamp(),
+        };
+        uint8_t raw[MIDI_CAPTURE_HEADER_SIZE];
+        midi_capture_header_encode(&header, raw);
+        ok = storage_file_write(recorder->file, raw, sizeof(raw)) == sizeof(raw);
+        if(!ok) storage_file_close(recorder->file);
+    }
+
+    if(ok) {
+        FURI_LOG_I(TAG, "Recording to %s", furi_string_get_cstr(path));
+        furi_stream_buffer_reset(recorder->stream);
+        recorder->records = 0;
+        recorder->dropped = 0;
+        recorder->active = true;
+    } else {
+        FURI_LOG_E(TAG, "Cannot create %s", furi_string_get_cstr(path));
+    }
+
+    return ok;
+}
+
+void midi_recorder_stop(MidiRecorder* recorder) {
+    if(!recorder->active) return;
+    midi_recorder_flush(recorder);
+    recorder->active = false;
+    storage_file_close(recorder->file);
+    FURI_LOG_I(TAG, "Recording stopped: %lu records, %lu dropped", recorder->records, recorder->dropped);
+}
+
+bool midi_recorder_is_active(const MidiRecorder* recorder) {
+    return recorder->active;
+}
+
+void midi_recorder_push(MidiRecorder* recorder, uint32_t timestamp, const uint8_t* packet) {
+    if(!recorder->active) return;
+
+    // A stream buffer write is all-or-partial: only send whole records
+    if(furi_stream_buffer_spaces_available(recorder->stream) < MIDI_CAPTURE_RECORD_SIZE) {
+        recorder->dropped++;
+        return;
+    }
+    uint8_t record[MIDI_CAPTURE_RECORD_SIZE];
+    midi_capture_record_encode(timestamp, packet, record);
+    furi_stream_buffer_send(recorder->stream, record, sizeof(record), 0);
+}
+
+size_t midi_recorder_flush(MidiRecorder* recorder) {
+    if(!recorder->active) return 0;
+
+    size_t written = 0;
+    size_t length;
+    while((length = furi_stream_buffer_receive(
+               recorder->stream, recorder->chunk, sizeof(recorder->chunk), 0)) > 0) {
+        if(storage_file_write(recorder->file, recorder->chunk, length) != length) {
+            FURI_LOG_E(TAG, "SD write failed, stopping");
+            recorder->active = false;
+            storage_file_close(recorder->file);
+            break;
+        }
+        written += length / MIDI_CAPTURE_RECORD_SIZE;
+    }
+
+    recorder->records += written;
+    return written;
+}
+
+const char* midi_recorder_path(const MidiRecorder* recorder) {
+    return furi_string_get_cstr(recorder->path);
+}
+
+uint32_t midi_recorder_pending(const MidiRecorder* recorder) {
+    return furi_stream_buffer_bytes_available(recorder->stream) / MIDI_CAPTURE_RECORD_SIZE;
+}
+
+uint32_t midi_recorder_records(const MidiRecorder* recorder) {
+    return recorder->records;
+}
+
+uint32_t midi_recorder_dropped(const MidiRecorder* recorder) {
+    return recorder->dropped;
+}
+
+#endif // MIDI_FEATURE_RECORDER
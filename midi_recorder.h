@@ -0,0 +1,37 @@
+#pragma once
+
+// Capture of raw USB MIDI packets to SD card (MIDI_FEATURE_RECORDER).
+// midi_recorder_push() only copies into a stream buffer and may be called
+// from the USB receive context; midi_recorder_flush() does the SD writes and
+// runs in the main loop. File format: see midi_capture.h.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MIDI_RECORDER_DIR APP_DATA_PATH("captures")
+#define MIDI_RECORDER_BUFFER_RECORDS 256 // Records buffered between flushes (2 KB)
+
+typedef struct MidiRecorder MidiRecorder;
+
+MidiRecorder* midi_recorder_alloc(void);
+void midi_recorder_free(MidiRecorder* recorder);
+
+// Open a new capture file (capture_000.mcap up), returns false if SD is not
+// available or capture_999 exists
+bool midi_recorder_start(MidiRecorder* recorder);
+// Flush remaining records and close the file
+void midi_recorder_stop(MidiRecorder* recorder);
+bool midi_recorder_is_active(const MidiRecorder* recorder);
+
+// Queue one packet, never blocks. Packets are dropped (and counted) when the buffer is full.
+void midi_recorder_push(MidiRecorder* recorder, uint32_t timestamp, const uint8_t* packet);
+// Write buffered records to SD, returns the number of records written
+size_t midi_recorder_flush(MidiRecorder* recorder);
+
+// Path of the current or last capture file, empty before the first start
+const char* midi_recorder_path(const MidiRecorder* recorder);
+// Records buffered, not written to SD yet
+uint32_t midi_recorder_pending(const MidiRecorder* recorder);
+uint32_t midi_recorder_records(const MidiRecorder* recorder);
+uint32_t midi_recorder_dropped(const MidiRecorder* recorder);
@@ -0,0 +1,72 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_SERVICE
+
+#include <furi.h>
+
+#include "midi_service.h"
+
+#define TAG "Mitzi_Midi_Svc"
+
+static int midi_service_subscribe(MidiService* service, uint8_t mask, FuriThreadId notify) {
+    furi_mutex_acquire(service->mutex, FuriWaitForever);
+    int consumer = midi_bus_subscribe(service->bus, mask);
+    if(consumer >= 0) service->notify[consumer] = notify;
+    furi_mutex_release(service->mutex);
+
+    FURI_LOG_I(TAG, "Consumer %d subscribed, mask 0x%02X", consumer, mask);
+    return consumer;
+}
+
+static void midi_service_unsubscribe(MidiService* service, int consumer) {
+    if(consumer < 0 || consumer >= MIDI_BUS_CONSUMERS) return;
+
+    furi_mutex_acquire(service->mutex, FuriWaitForever);
+    midi_bus_unsubscribe(service->bus, consumer);
+    service->notify[consumer] = NULL;
+    furi_mutex_release(service->mutex);
+}
+
+MidiService* midi_service_alloc(const MidiChannelState* channels) {
+    MidiService* service = malloc(sizeof(MidiService));
+    memset(service, 0, sizeof(MidiService));
+    service->version = MIDI_SERVICE_VERSION;
+    service->bus = &service->ring;
+    service->channels = channels;
+    service->subscribe = midi_service_subscribe;
+    service->unsubscribe = midi_service_unsubscribe;
+    service->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    midi_bus_init(&service->ring, service->records, MIDI_SERVICE_RING);
+
+    furi_record_create(RECORD_MIDI, service);
+    return service;
+}
+
+void midi_service_free(MidiService* service) {
+    // Consumers still holding the record keep it alive: wait for them, but not forever
+    for(uint32_t tries = 0; !furi_record_destroy(RECORD_MIDI); tries++) {
+        if(tries == MIDI_SERVICE_CLOSE_TRIES) {
+            FURI_LOG_E(TAG, "A consumer keeps " RECORD_MIDI " open, leaving the service allocated");
+            return;
+        }
+        FURI_LOG_W(TAG, "Waiting for consumers to close " RECORD_MIDI);
+        furi_delay_ms(MIDI_SERVICE_CLOSE_WAIT_MS);
+    }
+    furi_mutex_free(service->mutex);
+    free(service);
+}
+
+void midi_service_publish(MidiService* service, const MidiMessage* messages, size_t count) {
+    if(count == 0) return;
+
+    uint8_t types = midi_bus_publish(&service->ring, messages, count);
+    for(int i = 0; i < MIDI_BUS_CONSUMERS; i++) {
+        const MidiBusConsumer* consumer = &service->ring.consumers[i];
+        FuriThreadId notify = service->notify[i];
+        if(consumer->active && notify && (consumer->mask & types)) {
+            furi_thread_flags_set(notify, MIDI_SERVICE_FLAG_DATA);
+        }
+    }
+}
+
+#endif // MIDI_FEATURE_SERVICE
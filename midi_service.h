@@ -0,0 +1,72 @@
+#pragma once
+
+// MIDI service for in-process consumers (MIDI_FEATURE_SERVICE).
+//
+// While Mitzi MIDI runs it publishes every decoded message under the
+// furi_record RECORD_MIDI. The loader runs one application at a time, so a
+// separate sequencer or tuner FAP cannot be running alongside to open it:
+// consumers are code in the same firmware process while the app runs, i.e.
+// threads the app starts and plugins it loads (.fal via the plugin manager),
+// which then need no USB MIDI handling of their own. Records are read in
+// place from a shared ring
+// (midi_bus.h); each consumer has its own cursor, type mask and overflow
+// counter. The consumer side needs only this header and midi_bus.h:
+//
+//     MidiService* midi = furi_record_open(RECORD_MIDI);
+//     int id = midi->subscribe(
+//         midi, MIDI_BUS_TYPE_BIT(MidiNoteOn) | MIDI_BUS_TYPE_BIT(MidiNoteOff),
+//         furi_thread_get_current_id());
+//     furi_thread_flags_wait(MIDI_SERVICE_FLAG_DATA, FuriFlagWaitAny, timeout);
+//     const MidiMessage* records;
+//     size_t count;
+//     while((count = midi_bus_peek(midi->bus, id, &records)) > 0) {
+//         for(size_t i = 0; i < count; i++) {
+//             if(midi_bus_wants(midi->bus, id, &records[i])) ...
+//         }
+//         midi_bus_release(midi->bus, id, count);
+//     }
+//     midi->unsubscribe(midi, id);
+//     furi_record_close(RECORD_MIDI);
+//
+// The service lives in the app's memory: on exit the app removes the record
+// and waits up to MIDI_SERVICE_CLOSE_TRIES * MIDI_SERVICE_CLOSE_WAIT_MS for
+// every consumer to close it. Consumers must close it before that.
+
+#include <furi.h>
+
+#include "midi_bus.h"
+
+#define RECORD_MIDI "mitzi_midi"
+#define MIDI_SERVICE_VERSION 1
+#define MIDI_SERVICE_RING 256         // Records in the shared ring (3 KB)
+#define MIDI_SERVICE_FLAG_DATA (1u << 0) // Thread flag set when wanted records arrive
+#define MIDI_SERVICE_CLOSE_WAIT_MS 100
+#define MIDI_SERVICE_CLOSE_TRIES 20 // Give up on consumers that keep the record open after 2 s
+
+typedef struct MidiService MidiService;
+
+struct MidiService {
+    uint32_t version;                  // MIDI_SERVICE_VERSION
+    MidiBus* bus;                      // Read with midi_bus_peek()/midi_bus_release()
+    const MidiChannelState* channels;  // Notes held, controllers etc., updated by the app without locking
+    // Returns the consumer id, -1 if all MIDI_BUS_CONSUMERS slots are in use.
+    // notify (may be NULL) gets MIDI_SERVICE_FLAG_DATA when wanted records are published.
+    int (*subscribe)(MidiService* service, uint8_t mask, FuriThreadId notify);
+    void (*unsubscribe)(MidiService* service, int consumer);
+
+    // Service side
+    FuriMutex* mutex; // Serializes subscribe/unsubscribe
+    FuriThreadId notify[MIDI_BUS_CONSUMERS];
+    MidiBus ring;
+    MidiMessage records[MIDI_SERVICE_RING];
+};
+
+// App side: create the service and its record / remove them. If a consumer
+// keeps the record open, free gives up after MIDI_SERVICE_CLOSE_TRIES and
+// leaves the service allocated (leaked) rather than free it under the consumer.
+MidiService* midi_service_alloc(const MidiChannelState* channels);
+void midi_service_free(MidiService* service);
+
+// Publish a decoded batch and wake up consumers that want any of it.
+// Called from the USB receive path, never blocks.
+void midi_service_publish(MidiService* service, const MidiMessage* messages, size_t count);
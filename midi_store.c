@@ -0,0 +1,41 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_RECORDER || MIDI_FEATURE_OUTPUT || MIDI_FEATURE_DIAGNOSTICS
+
+#include <furi.h>
+#include <storage/storage.h>
+
+#include "midi_store.h"
+
+size_t midi_store_load(const char* path, void* data, size_t size) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    size_t length = 0;
+    if(storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        length = storage_file_read(file, data, size);
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    return length;
+}
+
+bool midi_store_save(const char* path, const void* data, size_t size) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, APP_DATA_PATH(""));
+    File* file = storage_file_alloc(storage);
+    bool ok = storage_file_open(file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS) &&
+              storage_file_write(file, data, size) == size;
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    return ok;
+}
+
+void midi_store_remove(const char* path) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_remove(storage, path);
+    furi_record_close(RECORD_STORAGE);
+}
+
+#endif // MIDI_FEATURE_RECORDER || MIDI_FEATURE_OUTPUT || MIDI_FEATURE_DIAGNOSTICS
@@ -0,0 +1,18 @@
+#pragma once
+
+// Small binary files in the app data folder (settings, tables), read and
+// written whole. Call from the main loop; SD access may block.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MIDI_STORE_VELOCITY APP_DATA_PATH("velocity.lut") // Calibrated velocity curve
+#define MIDI_STORE_POSTMORTEM APP_DATA_PATH("stall.pmr") // Last main loop stall (midi_watchdog.h)
+#define MIDI_STORE_QUEUE APP_DATA_PATH("queue.stats") // Event queue bursts (midi_queue_stats.h)
+
+// Read up to size bytes, returns the number read (0 if the file is missing)
+size_t midi_store_load(const char* path, void* data, size_t size);
+// Replace the file, returns false if the SD card is not available
+bool midi_store_save(const char* path, const void* data, size_t size);
+void midi_store_remove(const char* path);
@@ -0,0 +1,83 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_OUTPUT
+
+#include "midi_thru.h"
+
+#include <string.h>
+
+void midi_thru_init(MidiThru* thru) {
+    memset(thru, 0, sizeof(MidiThru));
+    memset(thru->cc_sent, 0xFF, sizeof(thru->cc_sent));
+}
+
+// Bytes after the status byte
+static uint8_t midi_thru_data_length(uint8_t status) {
+    switch(status & 0xF0) {
+    case MidiProgramChange:
+    case MidiChannelAftertouch:
+        return 1;
+    case MidiSystemMessage:
+        switch(status) {
+        case 0xF1: // MTC quarter frame
+        case 0xF3: // Song select
+            return 1;
+        case 0xF2: // Song position
+            return 2;
+        default:
+            return 0;
+        }
+    default:
+        return 2;
+    }
+}
+
+// Returns false if a Control Change only reverses the last sent value by one
+static bool midi_thru_hysteresis(MidiThru* thru, const MidiMessage* message) {
+    uint8_t channel = message->channel & 0x0F;
+    uint8_t controller = message->data1 & 0x7F;
+    // Unflagged controls are only tracked, so filtering starts from the right value
+    bool filter = !thru->jitter || midi_jitter_is_jittery(thru->jitter, channel, controller);
+
+    uint8_t sent = thru->cc_sent[channel][controller];
+    uint8_t value = message->data2;
+    uint8_t bit = 1 << (controller & 7);
+    uint8_t* down = &thru->cc_down[channel][controller >> 3];
+
+    if(sent != 0xFF) {
+        int diff = (int)value - (int)sent;
+        bool was_down = *down & bit;
+        if(filter && (diff == 0 || (diff == 1 && was_down) || (diff == -1 && !was_down))) {
+            return false;
+        }
+        if(diff < 0) {
+            *down |= bit;
+        } else if(diff > 0) {
+            *down &= ~bit;
+        }
+    }
+    thru->cc_sent[channel][controller] = value;
+    return true;
+}
+
+size_t midi_thru_process(MidiThru* thru, const MidiMessage* message, uint8_t* out) {
+    if(message->status == MIDI_SYSEX_START || message->status == MIDI_SYSEX_END) return 0;
+
+    if(thru->hysteresis && message->type == MidiControlChange &&
+       !midi_thru_hysteresis(thru, message)) {
+        thru->suppressed++;
+        return 0;
+    }
+
+    uint8_t length = midi_thru_data_length(message->status);
+    out[0] = message->status;
+    if(length > 0) out[1] = message->data1;
+    if(length > 1) out[2] = message->data2;
+    if(thru->velocity && message->type == MidiNoteOn && message->data2 > 0) {
+        out[2] = midi_velocity_apply(thru->velocity, message->data2);
+    }
+    thru->forwarded++;
+    return 1 + length;
+}
+
+#endif // MIDI_FEATURE_OUTPUT
@@ -0,0 +1,49 @@
+#pragma once
+
+// MIDI thru: turns decoded messages back into MIDI bytes for an output port,
+// with optional processing stages.
+//
+// Stages:
+//   hysteresis - suppresses Control Changes that only reverse the last sent
+//                value by one step (64 65 64 65 ... leaves as 64 65). With a
+//                jitter detector attached, only controls it flags are
+//                filtered; without one, every controller is.
+//   velocity   - maps Note On velocities through a 128-entry table
+//                (midi_velocity.h), one lookup per note.
+//
+// SysEx is not forwarded (the decoder hands over complete messages only in
+// the receive buffer).
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "midi_core.h"
+#include "midi_jitter.h"
+#include "midi_velocity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIDI_THRU_MAX_BYTES 3 // Longest message produced
+
+typedef struct {
+    bool hysteresis;          // Hysteresis stage enabled
+    const MidiJitter* jitter; // Detector deciding which controls are filtered (may be NULL)
+    const uint8_t* velocity;  // Velocity curve, MIDI_VELOCITY_LUT_SIZE entries (NULL = off)
+    uint8_t cc_sent[16][128]; // Last value sent per controller, 0xFF = none
+    uint8_t cc_down[16][16];  // Bit set: last sent change went down
+    uint32_t forwarded;
+    uint32_t suppressed;      // Dropped by the hysteresis stage
+} MidiThru;
+
+void midi_thru_init(MidiThru* thru);
+
+// Run the stages and encode the message into out (at least MIDI_THRU_MAX_BYTES).
+// Returns the number of bytes, 0 if the message is dropped.
+size_t midi_thru_process(MidiThru* thru, const MidiMessage* message, uint8_t* out);
+
+#ifdef __cplusplus
+}
+#endif
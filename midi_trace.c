@@ -0,0 +1,99 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_RECORDER
+
+#include "midi_trace.h"
+
+#include <string.h>
+
+static inline void put_le16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static inline void put_le32(uint8_t* out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = value >> 24;
+}
+
+static inline uint16_t get_le16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+static inline uint32_t get_le32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+void midi_trace_init(MidiTrace* trace, MidiTraceEvent* events, uint32_t capacity) {
+    trace->events = events;
+    trace->capacity = capacity;
+    trace->enabled = false;
+    midi_trace_reset(trace);
+}
+
+void midi_trace_reset(MidiTrace* trace) {
+    memset(trace->events, 0, trace->capacity * sizeof(MidiTraceEvent));
+    trace->head = 0;
+}
+
+uint32_t midi_trace_count(const MidiTrace* trace, uint32_t* first) {
+    uint32_t head = __atomic_load_n(&trace->head, __ATOMIC_ACQUIRE);
+    uint32_t count = head < trace->capacity ? head : trace->capacity;
+    *first = head - count;
+    return count;
+}
+
+size_t midi_trace_encode(
+    const MidiTrace* trace,
+    uint32_t ticks_per_second,
+    uint32_t clock_tick,
+    uint8_t* out) {
+    uint32_t first;
+    uint32_t count = midi_trace_count(trace, &first);
+    midi_trace_header_encode(ticks_per_second, count, clock_tick, out);
+    uint8_t* event = out + MIDI_TRACE_HEADER_SIZE;
+    for(uint32_t i = 0; i < count; i++, event += MIDI_TRACE_EVENT_SIZE) {
+        midi_trace_event_encode(midi_trace_at(trace, first + i), event);
+    }
+    return MIDI_TRACE_FILE_SIZE(count);
+}
+
+void midi_trace_header_encode(
+    uint32_t ticks_per_second,
+    uint32_t count,
+    uint32_t clock_tick,
+    uint8_t* out) {
+    memcpy(out, MIDI_TRACE_MAGIC, 4);
+    put_le16(&out[4], MIDI_TRACE_VERSION);
+    put_le16(&out[6], MIDI_TRACE_EVENT_SIZE);
+    put_le32(&out[8], ticks_per_second);
+    put_le32(&out[12], count);
+    put_le32(&out[16], clock_tick);
+}
+
+bool midi_trace_header_decode(
+    const uint8_t* data,
+    uint32_t* ticks_per_second,
+    uint32_t* count,
+    uint32_t* clock_tick) {
+    if(memcmp(data, MIDI_TRACE_MAGIC, 4) != 0) return false;
+    *ticks_per_second = get_le32(&data[8]);
+    *count = get_le32(&data[12]);
+    *clock_tick = get_le32(&data[16]);
+    return get_le16(&data[4]) == MIDI_TRACE_VERSION &&
+           get_le16(&data[6]) == MIDI_TRACE_EVENT_SIZE;
+}
+
+void midi_trace_event_encode(const MidiTraceEvent* event, uint8_t* out) {
+    put_le32(out, event->time);
+    put_le32(&out[4], event->word);
+}
+
+void midi_trace_event_decode(const uint8_t* data, MidiTraceEvent* event) {
+    event->time = get_le32(data);
+    event->word = get_le32(&data[4]);
+}
+
+#endif // MIDI_FEATURE_RECORDER
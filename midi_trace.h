@@ -0,0 +1,134 @@
+#pragma once
+
+// Timeline trace: a bounded ring of span and instant events for looking at
+// individual bursts (which packets arrived while the GUI held the mutex, when
+// the event queue filled up). The newest events are kept; older ones are
+// overwritten.
+//
+// Recording is lock-free and may happen from any thread or the USB receive
+// context: a writer claims a slot with an atomic increment and fills it. Stop
+// recording before reading the ring.
+//
+// Times are caller ticks (DWT cycles on the device, 32-bit wrapping).
+// MidiTraceClock instants carry the kernel tick, so tools can unwrap the
+// cycle counter; record one at least every MIDI_TRACE_CLOCK_MS. Their arg
+// only has room for 24 bits (4.66 h of uptime), so the file header holds the
+// full tick of the last clock instant to line the trace up with a capture.
+//
+// File format (.mtrc, little endian):
+//   header: "MTRC" | version u16 | event size u16 | ticks per second u32 | event count u32
+//           | tick of the last clock instant u32
+//   event:  time u32 | type (bits 0-1) | id (bits 2-7) | arg (bits 8-31)
+// tools/trace_export.py turns it into Chrome trace JSON for Perfetto.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIDI_TRACE_MAGIC "MTRC"
+#define MIDI_TRACE_VERSION 2
+#define MIDI_TRACE_HEADER_SIZE 20
+#define MIDI_TRACE_EVENT_SIZE 8
+#define MIDI_TRACE_EXTENSION ".mtrc"
+#define MIDI_TRACE_CLOCK_MS 10000 // Well inside the 67 s wrap of a 64 MHz cycle counter
+
+typedef enum {
+    MidiTraceInstant,
+    MidiTraceBegin,
+    MidiTraceEnd,
+    MidiTraceCounter,
+} MidiTraceType;
+
+// Event names; the trace tools map each to a track (thread)
+typedef enum {
+    MidiTraceClock,      // Instant, arg = kernel tick (ms, low 24 bits)
+    MidiTraceUsbRx,      // Span: one USB transfer decoded, arg = bytes
+    MidiTraceMidiIn,     // Instant: message decoded, arg = status | data1 << 8 | data2 << 16
+    MidiTraceQueueFull,  // Instant: event dropped, the main loop queue was full
+    MidiTraceQueue,      // Counter: events waiting in the main loop queue
+    MidiTraceMainLock,   // Span: main loop holds the app mutex, arg = event type
+    MidiTraceRenderLock, // Span: render_callback holds the app mutex, arg = screen
+} MidiTraceId;
+
+typedef struct {
+    uint32_t time;
+    uint32_t word; // type | id << 2 | arg << 8
+} MidiTraceEvent;
+
+typedef struct {
+    MidiTraceEvent* events;
+    uint32_t capacity; // Power of two
+    uint32_t head;     // Events recorded since the last reset
+    volatile bool enabled;
+} MidiTrace;
+
+void midi_trace_init(MidiTrace* trace, MidiTraceEvent* events, uint32_t capacity);
+// Drop all events (not while recording)
+void midi_trace_reset(MidiTrace* trace);
+
+static inline void midi_trace_add(
+    MidiTrace* trace,
+    uint32_t time,
+    MidiTraceType type,
+    MidiTraceId id,
+    uint32_t arg) {
+    if(!trace->enabled) return;
+    uint32_t slot = __atomic_fetch_add(&trace->head, 1, __ATOMIC_RELAXED);
+    MidiTraceEvent* event = &trace->events[slot & (trace->capacity - 1)];
+    event->time = time;
+    event->word = type | (uint32_t)id << 2 | arg << 8;
+}
+
+static inline MidiTraceType midi_trace_type(const MidiTraceEvent* event) {
+    return event->word & 0x03;
+}
+
+static inline MidiTraceId midi_trace_id(const MidiTraceEvent* event) {
+    return (event->word >> 2) & 0x3F;
+}
+
+static inline uint32_t midi_trace_arg(const MidiTraceEvent* event) {
+    return event->word >> 8;
+}
+
+// Events still in the ring, oldest first: index i is midi_trace_at(trace, first + i)
+uint32_t midi_trace_count(const MidiTrace* trace, uint32_t* first);
+
+static inline const MidiTraceEvent* midi_trace_at(const MidiTrace* trace, uint32_t index) {
+    return &trace->events[index & (trace->capacity - 1)];
+}
+
+// Bytes of a file holding up to capacity events
+#define MIDI_TRACE_FILE_SIZE(capacity) (MIDI_TRACE_HEADER_SIZE + (capacity) * MIDI_TRACE_EVENT_SIZE)
+
+// Whole file (header and the events in the ring, oldest first) into out of
+// MIDI_TRACE_FILE_SIZE(trace->capacity) bytes, so it can be written at once.
+// clock_tick is the full kernel tick of the newest MidiTraceClock. Returns
+// the bytes used. Not while recording.
+size_t midi_trace_encode(
+    const MidiTrace* trace,
+    uint32_t ticks_per_second,
+    uint32_t clock_tick,
+    uint8_t* out);
+
+void midi_trace_header_encode(
+    uint32_t ticks_per_second,
+    uint32_t count,
+    uint32_t clock_tick,
+    uint8_t* out);
+// Returns false if magic, version or event size do not match
+bool midi_trace_header_decode(
+    const uint8_t* data,
+    uint32_t* ticks_per_second,
+    uint32_t* count,
+    uint32_t* clock_tick);
+void midi_trace_event_encode(const MidiTraceEvent* event, uint8_t* out);
+void midi_trace_event_decode(const uint8_t* data, MidiTraceEvent* event);
+
+#ifdef __cplusplus
+}
+#endif
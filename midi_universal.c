@@ -0,0 +1,420 @@
+#include "midi_config.h"
+#include "midi_universal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Offsets inside F0 7E/7F dev sub1 sub2 ... F7
+#define UNI_DEVICE 2
+#define UNI_SUB1 3
+#define UNI_SUB2 4
+#define UNI_PAYLOAD 5
+
+typedef bool (*UniversalHandler)(const uint8_t* sysex, size_t length, MidiUniversalEvent* event);
+
+typedef struct {
+    MidiUniversalKind kind;
+    uint16_t min_length;      // Whole message including F0 and F7
+    UniversalHandler handler; // NULL: nothing to parse besides the IDs
+} UniversalRule;
+
+typedef struct {
+    uint8_t any;         // Rule used for every sub-ID2 (MMC), 0 = look up by_sub2
+    uint8_t by_sub2[16]; // Rule per sub-ID2 0x00-0x0F
+} UniversalRow;
+
+static inline uint16_t get_14bit(const uint8_t* data) {
+    return (data[0] & 0x7F) | ((data[1] & 0x7F) << 7); // LSB first
+}
+
+static bool parse_identity_reply(const uint8_t* sysex, size_t length, MidiUniversalEvent* event) {
+    size_t i = UNI_PAYLOAD;
+    event->identity.manufacturer = sysex[i++];
+    if(event->identity.manufacturer == 0x00) i += 2; // Extended 3-byte ID
+    if(length < i + 4 + 4 + 1) return false;
+    event->identity.family = get_14bit(&sysex[i]);
+    event->identity.member = get_14bit(&sysex[i + 2]);
+    return true;
+}
+
+static bool parse_program(const uint8_t* sysex, size_t length, MidiUniversalEvent* event) {
+    (void)length;
+    event->mts.bank = 0;
+    event->mts.program = sysex[UNI_PAYLOAD];
+    return true;
+}
+
+// Shared by the real-time form (program count notes...) and the banked one (bank program count notes...)
+static bool parse_note_change_at(const uint8_t* sysex, size_t length, MidiUniversalEvent* event, size_t i) {
+    event->mts.program = sysex[i];
+    uint8_t count = sysex[i + 1];
+    size_t room = (length - 1 - (i + 2)) / 4; // Notes that are actually in the message
+    event->mts.count = count < room ? count : (uint8_t)room;
+    event->data = &sysex[i + 2];
+    return event->mts.count > 0;
+}
+
+static bool parse_note_change(const uint8_t* sysex, size_t length, MidiUniversalEvent* event) {
+    event->mts.bank = 0;
+    return parse_note_change_at(sysex, length, event, UNI_PAYLOAD);
+}
+
+static bool parse_note_change_bank(const uint8_t* sysex, size_t length, MidiUniversalEvent* event) {
+    event->mts.bank = sysex[UNI_PAYLOAD];
+    return parse_note_change_at(sysex, length, event, UNI_PAYLOAD + 1);
+}
+
+// Bulk dump: program, name, 128 x (xx yy zz), checksum (XOR of everything
+// between F0 and the checksum)
+static bool parse_bulk_dump_at(const uint8_t* sysex, size_t length, MidiUniversalEvent* event, size_t i) {
+    uint8_t checksum = 0;
+    for(size_t j = 1; j < length - 2; j++) checksum ^= sysex[j];
+    if((checksum & 0x7F) != sysex[length - 2]) return false;
+
+    event->mts.program = sysex[i];
+    event->mts.count = 128;
+    event->data = &sysex[i + 1 + MIDI_MTS_NAME];
+    return true;
+}
+
+static bool parse_bulk_dump(const uint8_t* sysex, size_t length, MidiUniversalEvent* event) {
+    event->mts.bank = 0;
+    return parse_bulk_dump_at(sysex, length, event, UNI_PAYLOAD);
+}
+
+static bool parse_bulk_dump_bank(const uint8_t* sysex, size_t length, MidiUniversalEvent* event) {
+    event->mts.bank = sysex[UNI_PAYLOAD];
+    return parse_bulk_dump_at(sysex, length, event, UNI_PAYLOAD + 1);
+}
+
+static bool parse_scale_octave(const uint8_t* sysex, size_t length, MidiUniversalEvent* event) {
+    (void)length;
+    const uint8_t* mask = &sysex[UNI_PAYLOAD];
+    // ff: channels 15-16, gg: 8-14, hh: 1-7
+    event->mts.channels = (mask[2] & 0x7F) | ((mask[1] & 0x7F) << 7) | ((mask[0] & 0x03) << 14);
+    event->data = &sysex[UNI_PAYLOAD + 3];
+    return true;
+}
+
+static bool parse_14bit(const uint8_t* sysex, size_t length, MidiUniversalEvent* event) {
+    (void)length;
+    event->value = get_14bit(&sysex[UNI_PAYLOAD]);
+    return true;
+}
+
+static bool parse_mmc(const uint8_t* sysex, size_t length, MidiUniversalEvent* event) {
+    (void)length;
+    event->mmc = sysex[UNI_SUB2];
+    return true;
+}
+
+enum {
+    RuleNone,
+    RuleIdentityRequest,
+    RuleIdentityReply,
+    RuleMtsBulkRequest,
+    RuleMtsBulkDump,
+    RuleMtsBulkDumpBank,
+    RuleMtsNoteChange,
+    RuleMtsNoteChangeBank,
+    RuleMtsScaleOctave,
+    RuleGmOn,
+    RuleGmOff,
+    RuleGm2On,
+    RuleMasterVolume,
+    RuleMasterBalance,
+    RuleMasterFineTune,
+    RuleMasterCoarseTune,
+    RuleMmc,
+};
+
+static const UniversalRule universal_rules[] = {
+    [RuleNone] = {MidiUniversalNone, 0, NULL},
+    [RuleIdentityRequest] = {MidiUniversalIdentityRequest, 6, NULL},
+    [RuleIdentityReply] = {MidiUniversalIdentityReply, 15, parse_identity_reply},
+    [RuleMtsBulkRequest] = {MidiUniversalMtsBulkRequest, 7, parse_program},
+    [RuleMtsBulkDump] = {MidiUniversalMtsBulkDump, MIDI_MTS_BULK_DUMP_SIZE, parse_bulk_dump},
+    [RuleMtsBulkDumpBank] = {MidiUniversalMtsBulkDump, MIDI_MTS_BULK_DUMP_SIZE + 1, parse_bulk_dump_bank},
+    [RuleMtsNoteChange] = {MidiUniversalMtsNoteChange, 12, parse_note_change},
+    [RuleMtsNoteChangeBank] = {MidiUniversalMtsNoteChange, 13, parse_note_change_bank},
+    [RuleMtsScaleOctave] = {MidiUniversalMtsScaleOctave, 21, parse_scale_octave},
+    [RuleGmOn] = {MidiUniversalGmOn, 6, NULL},
+    [RuleGmOff] = {MidiUniversalGmOff, 6, NULL},
+    [RuleGm2On] = {MidiUniversalGm2On, 6, NULL},
+    [RuleMasterVolume] = {MidiUniversalMasterVolume, 8, parse_14bit},
+    [RuleMasterBalance] = {MidiUniversalMasterBalance, 8, parse_14bit},
+    [RuleMasterFineTune] = {MidiUniversalMasterFineTune, 8, parse_14bit},
+    [RuleMasterCoarseTune] = {MidiUniversalMasterCoarseTune, 8, parse_14bit},
+    [RuleMmc] = {MidiUniversalMmc, 6, parse_mmc},
+};
+
+enum {
+    RowNone,
+    RowGeneralInfo,
+    RowMtsNonRealtime,
+    RowGeneralMidi,
+    RowDeviceControl,
+    RowMmc,
+    RowMtsRealtime,
+};
+
+static const UniversalRow universal_row_table[] = {
+    [RowNone] = {0, {0}},
+    [RowGeneralInfo] = {0, {[0x01] = RuleIdentityRequest, [0x02] = RuleIdentityReply}},
+    [RowMtsNonRealtime] =
+        {0,
+         {[0x00] = RuleMtsBulkRequest,
+          [0x01] = RuleMtsBulkDump,
+          [0x04] = RuleMtsBulkDumpBank,
+          [0x07] = RuleMtsNoteChangeBank,
+          [0x08] = RuleMtsScaleOctave}},
+    [RowGeneralMidi] = {0, {[0x01] = RuleGmOn, [0x02] = RuleGmOff, [0x03] = RuleGm2On}},
+    [RowDeviceControl] =
+        {0,
+         {[0x01] = RuleMasterVolume,
+          [0x02] = RuleMasterBalance,
+          [0x03] = RuleMasterFineTune,
+          [0x04] = RuleMasterCoarseTune}},
+    [RowMmc] = {RuleMmc, {0}},
+    [RowMtsRealtime] =
+        {0, {[0x02] = RuleMtsNoteChange, [0x07] = RuleMtsNoteChangeBank, [0x08] = RuleMtsScaleOctave}},
+};
+
+// [realtime][sub-ID1] -> row
+static const uint8_t universal_rows[2][16] = {
+    {[0x06] = RowGeneralInfo, [0x08] = RowMtsNonRealtime, [0x09] = RowGeneralMidi},
+    {[0x04] = RowDeviceControl, [0x06] = RowMmc, [0x08] = RowMtsRealtime},
+};
+
+static const uint8_t gs_reset[] = {0xF0, 0x41, 0x00, 0x42, 0x12, 0x40, 0x00, 0x7F, 0x00, 0x41, 0xF7};
+
+bool midi_universal_decode(const uint8_t* sysex, size_t length, MidiUniversalEvent* event) {
+    memset(event, 0, sizeof(MidiUniversalEvent));
+    if(length < 6 || sysex[0] != 0xF0 || sysex[length - 1] != 0xF7) return false;
+
+    if(sysex[1] == gs_reset[1]) {
+        // Compare everything but the device ID
+        if(length != sizeof(gs_reset) || memcmp(&sysex[3], &gs_reset[3], sizeof(gs_reset) - 3) != 0) {
+            return false;
+        }
+        event->kind = MidiUniversalGsReset;
+        event->device = sysex[UNI_DEVICE];
+        return true;
+    }
+
+    if(sysex[1] != MIDI_UNIVERSAL_NON_REALTIME && sysex[1] != MIDI_UNIVERSAL_REALTIME) return false;
+    uint8_t sub1 = sysex[UNI_SUB1];
+    uint8_t sub2 = sysex[UNI_SUB2];
+    if(sub1 > 0x0F) return false;
+
+    const UniversalRow* row = &universal_row_table[universal_rows[sysex[1] & 1][sub1]];
+    uint8_t rule_index = row->any ? row->any : (sub2 <= 0x0F ? row->by_sub2[sub2] : RuleNone);
+    const UniversalRule* rule = &universal_rules[rule_index];
+    if(rule->kind == MidiUniversalNone || length < rule->min_length) return false;
+
+    event->kind = rule->kind;
+    event->device = sysex[UNI_DEVICE];
+    if(rule->handler && !rule->handler(sysex, length, event)) {
+        event->kind = MidiUniversalNone;
+        return false;
+    }
+    return true;
+}
+
+#if MIDI_FEATURE_ANALYZERS
+
+// Tracked state (master volume, GM mode, MTS tables) is kept for the analyzer
+// screens only; decoding and formatting stay in the core for the history.
+
+static void tuning_table_init(MidiTuningTable* table, uint8_t bank, uint8_t program) {
+    table->bank = bank;
+    table->program = program;
+    for(uint8_t note = 0; note < 128; note++) {
+        table->note[note] = (uint32_t)note << 14; // Equal temperament
+    }
+}
+
+void midi_universal_state_reset(MidiUniversalState* state) {
+    memset(state, 0, sizeof(MidiUniversalState));
+    state->master_volume = 0x3FFF;
+    state->master_balance = 0x2000;
+    state->master_fine_tune = 0x2000;
+    state->master_coarse_tune = 0x2000;
+    for(uint8_t i = 0; i < MIDI_MTS_PROGRAMS; i++) {
+        tuning_table_init(&state->tuning[i], 0, 0xFF);
+    }
+}
+
+static MidiTuningTable* tuning_slot(MidiUniversalState* state, uint8_t bank, uint8_t program) {
+    for(uint8_t i = 0; i < MIDI_MTS_PROGRAMS; i++) {
+        if(state->tuning[i].program == program && state->tuning[i].bank == bank) return &state->tuning[i];
+    }
+    MidiTuningTable* table = &state->tuning[state->tuning_next];
+    state->tuning_next = (state->tuning_next + 1) % MIDI_MTS_PROGRAMS;
+    tuning_table_init(table, bank, program);
+    return table;
+}
+
+void midi_universal_apply(MidiUniversalState* state, const MidiUniversalEvent* event) {
+    switch(event->kind) {
+    case MidiUniversalMtsNoteChange: {
+        MidiTuningTable* table = tuning_slot(state, event->mts.bank, event->mts.program);
+        for(uint8_t i = 0; i < event->mts.count; i++) {
+            const uint8_t* change = &event->data[i * 4]; // kk xx yy zz
+            uint32_t frequency = ((uint32_t)(change[1] & 0x7F) << 14) | ((change[2] & 0x7F) << 7) |
+                                 (change[3] & 0x7F);
+            if(frequency != MIDI_MTS_NO_CHANGE) table->note[change[0] & 0x7F] = frequency;
+        }
+        break;
+    }
+    case MidiUniversalMtsBulkDump: {
+        MidiTuningTable* table = tuning_slot(state, event->mts.bank, event->mts.program);
+        for(uint8_t note = 0; note < 128; note++) {
+            const uint8_t* tuning = &event->data[note * 3]; // xx yy zz
+            uint32_t frequency = ((uint32_t)(tuning[0] & 0x7F) << 14) | ((tuning[1] & 0x7F) << 7) |
+                                 (tuning[2] & 0x7F);
+            if(frequency != MIDI_MTS_NO_CHANGE) table->note[note] = frequency;
+        }
+        break;
+    }
+    case MidiUniversalMtsScaleOctave:
+        for(uint8_t ch = 0; ch < 16; ch++) {
+            if(!(event->mts.channels & (1 << ch))) continue;
+            for(uint8_t pc = 0; pc < 12; pc++) {
+                state->scale_octave[ch][pc] = (int8_t)((event->data[pc] & 0x7F) - 64);
+            }
+        }
+        break;
+    case MidiUniversalGmOn:
+    case MidiUniversalGmOff:
+    case MidiUniversalGm2On:
+    case MidiUniversalGsReset:
+        state->system_mode = event->kind;
+        state->master_volume = 0x3FFF;
+        state->master_balance = 0x2000;
+        break;
+    case MidiUniversalMasterVolume:
+        state->master_volume = event->value;
+        break;
+    case MidiUniversalMasterBalance:
+        state->master_balance = event->value;
+        break;
+    case MidiUniversalMasterFineTune:
+        state->master_fine_tune = event->value;
+        break;
+    case MidiUniversalMasterCoarseTune:
+        state->master_coarse_tune = event->value;
+        break;
+    case MidiUniversalMmc:
+        state->mmc_last = event->mmc;
+        break;
+    default:
+        break;
+    }
+}
+
+uint32_t midi_universal_note_tuning(const MidiUniversalState* state, uint8_t program, uint8_t note) {
+    for(uint8_t i = 0; i < MIDI_MTS_PROGRAMS; i++) {
+        if(state->tuning[i].program == program) return state->tuning[i].note[note & 0x7F];
+    }
+    return (uint32_t)(note & 0x7F) << 14;
+}
+
+#endif // MIDI_FEATURE_ANALYZERS
+
+static const char* mmc_name(uint8_t command) {
+    switch(command) {
+    case MidiMmcStop:
+        return "Stop";
+    case MidiMmcPlay:
+        return "Play";
+    case MidiMmcDeferredPlay:
+        return "DefPlay";
+    case MidiMmcFastForward:
+        return "FFwd";
+    case MidiMmcRewind:
+        return "Rewind";
+    case MidiMmcRecordStrobe:
+        return "Record";
+    case MidiMmcRecordExit:
+        return "RecExit";
+    case MidiMmcRecordPause:
+        return "RecPause";
+    case MidiMmcPause:
+        return "Pause";
+    case MidiMmcEject:
+        return "Eject";
+    case MidiMmcChase:
+        return "Chase";
+    case MidiMmcReset:
+        return "Reset";
+    case MidiMmcWrite:
+        return "Write";
+    case MidiMmcLocate:
+        return "Locate";
+    case MidiMmcShuttle:
+        return "Shuttle";
+    default:
+        return NULL;
+    }
+}
+
+void midi_universal_format(const MidiUniversalEvent* event, char* buffer, size_t size) {
+    switch(event->kind) {
+    case MidiUniversalIdentityRequest:
+        snprintf(buffer, size, "IdReq   Dev%02X", event->device);
+        break;
+    case MidiUniversalIdentityReply:
+        snprintf(buffer, size, "IdReply %02X %04X/%04X", event->identity.manufacturer,
+                 event->identity.family, event->identity.member);
+        break;
+    case MidiUniversalMtsBulkRequest:
+        snprintf(buffer, size, "MTS Req Prg%03d", event->mts.program);
+        break;
+    case MidiUniversalMtsBulkDump:
+        snprintf(buffer, size, "MTS Dump Prg%03d", event->mts.program);
+        break;
+    case MidiUniversalMtsNoteChange:
+        snprintf(buffer, size, "MTS Note Prg%03d x%d", event->mts.program, event->mts.count);
+        break;
+    case MidiUniversalMtsScaleOctave:
+        snprintf(buffer, size, "MTS Oct Ch%04X", event->mts.channels);
+        break;
+    case MidiUniversalGmOn:
+        snprintf(buffer, size, "GM System On");
+        break;
+    case MidiUniversalGmOff:
+        snprintf(buffer, size, "GM System Off");
+        break;
+    case MidiUniversalGm2On:
+        snprintf(buffer, size, "GM2 System On");
+        break;
+    case MidiUniversalGsReset:
+        snprintf(buffer, size, "GS Reset");
+        break;
+    case MidiUniversalMasterVolume:
+        snprintf(buffer, size, "MstrVol %05d", event->value);
+        break;
+    case MidiUniversalMasterBalance:
+        snprintf(buffer, size, "MstrBal %+05d", event->value - 8192);
+        break;
+    case MidiUniversalMasterFineTune:
+        snprintf(buffer, size, "MstrFin %+05d", event->value - 8192);
+        break;
+    case MidiUniversalMasterCoarseTune:
+        snprintf(buffer, size, "MstrCrs %+03d", (event->value >> 7) - 64);
+        break;
+    case MidiUniversalMmc: {
+        const char* name = mmc_name(event->mmc);
+        if(name) {
+            snprintf(buffer, size, "MMC     %s", name);
+        } else {
+            snprintf(buffer, size, "MMC     0x%02X", event->mmc);
+        }
+        break;
+    }
+    default:
+        snprintf(buffer, size, "System  0xF0");
+        break;
+    }
+}
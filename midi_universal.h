@@ -0,0 +1,119 @@
+#pragma once
+
+// Universal Real-Time (F0 7F) / Non-Real-Time (F0 7E) SysEx decoder.
+//
+// Dispatch is table driven: sub-ID1 selects a row, sub-ID2 a rule in that row
+// (MMC uses one rule for every command), so decoding a reassembled message
+// costs two table lookups plus the rule's handler. Decoded messages become a
+// typed MidiUniversalEvent; midi_universal_apply() keeps the tracked state
+// (master volume, GM mode, MTS tuning tables) up to date.
+//
+// Also recognised: the Roland GS Reset, which acts like GM System On.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIDI_UNIVERSAL_NON_REALTIME 0x7E
+#define MIDI_UNIVERSAL_REALTIME 0x7F
+#define MIDI_MTS_PROGRAMS 2 // Tuning programs tracked (512 bytes each)
+#define MIDI_MTS_NO_CHANGE 0x1FFFFF // 7F 7F 7F in a note change: leave the note alone
+#define MIDI_MTS_NAME 16 // Tuning name in a bulk dump
+#define MIDI_MTS_BULK_DUMP_SIZE 408 // F0 7E dev 08 01 program name 128 x (xx yy zz) checksum F7
+#define MIDI_MTS_NOTE_CHANGE_MAX 518 // Banked note change with 127 notes, the longest MTS message
+
+typedef enum {
+    MidiUniversalNone,            // Not universal, or not decoded
+    MidiUniversalIdentityRequest, // 7E dev 06 01
+    MidiUniversalIdentityReply,   // 7E dev 06 02 mfr family member version
+    MidiUniversalMtsBulkRequest,  // 7E dev 08 00 program
+    MidiUniversalMtsBulkDump,     // 7E dev 08 01 program / 08 04 bank program: all 128 notes
+    MidiUniversalMtsNoteChange,   // 7F dev 08 02 / 7E dev 08 07: per-note tuning
+    MidiUniversalMtsScaleOctave,  // 7E/7F dev 08 08: 12 cents offsets per channel
+    MidiUniversalGmOn,            // 7E dev 09 01
+    MidiUniversalGmOff,           // 7E dev 09 02
+    MidiUniversalGm2On,           // 7E dev 09 03
+    MidiUniversalGsReset,         // Roland F0 41 dev 42 12 40 00 7F 00 41 F7
+    MidiUniversalMasterVolume,    // 7F dev 04 01 lsb msb
+    MidiUniversalMasterBalance,   // 7F dev 04 02 lsb msb
+    MidiUniversalMasterFineTune,  // 7F dev 04 03 lsb msb
+    MidiUniversalMasterCoarseTune,// 7F dev 04 04 lsb msb
+    MidiUniversalMmc,             // 7F dev 06 command
+} MidiUniversalKind;
+
+// MMC commands (sub-ID2 of F0 7F dev 06)
+typedef enum {
+    MidiMmcStop = 0x01,
+    MidiMmcPlay = 0x02,
+    MidiMmcDeferredPlay = 0x03,
+    MidiMmcFastForward = 0x04,
+    MidiMmcRewind = 0x05,
+    MidiMmcRecordStrobe = 0x06,
+    MidiMmcRecordExit = 0x07,
+    MidiMmcRecordPause = 0x08,
+    MidiMmcPause = 0x09,
+    MidiMmcEject = 0x0A,
+    MidiMmcChase = 0x0B,
+    MidiMmcReset = 0x0D,
+    MidiMmcWrite = 0x40,
+    MidiMmcLocate = 0x44,
+    MidiMmcShuttle = 0x47,
+} MidiMmcCommand;
+
+typedef struct {
+    MidiUniversalKind kind;
+    uint8_t device; // Device ID, 0x7F = all
+    union {
+        uint16_t value; // Master volume/balance/tuning (14 bit)
+        uint8_t mmc;    // MidiMmcCommand
+        struct {
+            uint8_t manufacturer; // First ID byte (0x00 = 3-byte ID follows)
+            uint16_t family;
+            uint16_t member;
+        } identity;
+        struct {
+            uint8_t bank;
+            uint8_t program;
+            uint8_t count;    // Notes in a note change, 128 in a bulk dump
+            uint16_t channels; // Channel mask of a scale/octave tuning
+        } mts;
+    };
+    const uint8_t* data; // MTS payload inside the SysEx (not kept after apply)
+} MidiUniversalEvent;
+
+// 21-bit MTS frequency per note: semitone << 14 | fraction (1/16384 semitone)
+typedef struct {
+    uint8_t program; // 0xFF = unused slot
+    uint8_t bank;
+    uint32_t note[128];
+} MidiTuningTable;
+
+typedef struct {
+    uint16_t master_volume;  // 14 bit, 16383 = full
+    uint16_t master_balance; // 14 bit, 8192 = center
+    uint16_t master_fine_tune;
+    uint16_t master_coarse_tune;
+    MidiUniversalKind system_mode; // Last GM On/Off, GM2 On or GS Reset
+    uint8_t mmc_last;              // Last MMC command
+    MidiTuningTable tuning[MIDI_MTS_PROGRAMS];
+    uint8_t tuning_next;           // Slot replaced when a new program shows up
+    int8_t scale_octave[16][12];   // Cents per pitch class and channel
+} MidiUniversalState;
+
+// Returns false (kind = MidiUniversalNone) for anything that is not decoded
+bool midi_universal_decode(const uint8_t* sysex, size_t length, MidiUniversalEvent* event);
+
+void midi_universal_state_reset(MidiUniversalState* state);
+void midi_universal_apply(MidiUniversalState* state, const MidiUniversalEvent* event);
+// Tuning of a note in a program, equal temperament if the program is unknown
+uint32_t midi_universal_note_tuning(const MidiUniversalState* state, uint8_t program, uint8_t note);
+
+void midi_universal_format(const MidiUniversalEvent* event, char* buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
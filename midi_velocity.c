@@ -0,0 +1,85 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_OUTPUT
+
+#include "midi_velocity.h"
+
+#include <math.h>
+#include <string.h>
+
+#define MIDI_VELOCITY_PRIOR 1 // Count every bin starts with
+
+const MidiVelocityTarget midi_velocity_targets[] = {
+    {"Equalize", 1, 127, 1.0f},
+    {"Soft", 1, 127, 1.5f},
+    {"Hard", 1, 127, 0.67f},
+    {"Narrow", 32, 112, 1.0f},
+};
+
+const size_t midi_velocity_target_count =
+    sizeof(midi_velocity_targets) / sizeof(midi_velocity_targets[0]);
+
+void midi_velocity_histogram_reset(MidiVelocityHistogram* histogram) {
+    memset(histogram, 0, sizeof(MidiVelocityHistogram));
+}
+
+void midi_velocity_histogram_add(MidiVelocityHistogram* histogram, uint8_t velocity) {
+    velocity &= 0x7F;
+    if(velocity == 0) return;
+    histogram->count[velocity]++;
+    histogram->total++;
+}
+
+void midi_velocity_lut_identity(uint8_t* lut) {
+    for(size_t i = 0; i < MIDI_VELOCITY_LUT_SIZE; i++) {
+        lut[i] = i;
+    }
+}
+
+void midi_velocity_lut_build(
+    const MidiVelocityHistogram* histogram,
+    const MidiVelocityTarget* target,
+    uint8_t* lut) {
+    float total = histogram->total + (float)MIDI_VELOCITY_PRIOR * (MIDI_VELOCITY_LUT_SIZE - 1);
+    float range = (float)target->high - target->low;
+    float below = 0; // Weight of all lower velocities
+
+    lut[0] = 0;
+    for(size_t v = 1; v < MIDI_VELOCITY_LUT_SIZE; v++) {
+        float weight = histogram->count[v] + MIDI_VELOCITY_PRIOR;
+        // Rank of the middle of this bin, 0..1
+        float rank = (below + weight / 2) / total;
+        below += weight;
+
+        float out = target->low + range * powf(rank, target->gamma) + 0.5f;
+        if(out < 1) out = 1;
+        if(out > 127) out = 127;
+        lut[v] = (uint8_t)out;
+    }
+}
+
+void midi_velocity_lut_encode(const uint8_t* lut, uint8_t* out) {
+    memcpy(out, MIDI_VELOCITY_FILE_MAGIC, 4);
+    out[4] = MIDI_VELOCITY_FILE_VERSION & 0xFF;
+    out[5] = MIDI_VELOCITY_FILE_VERSION >> 8;
+    out[6] = MIDI_VELOCITY_LUT_SIZE & 0xFF;
+    out[7] = MIDI_VELOCITY_LUT_SIZE >> 8;
+    memcpy(&out[8], lut, MIDI_VELOCITY_LUT_SIZE);
+}
+
+bool midi_velocity_lut_decode(const uint8_t* data, size_t length, uint8_t* lut) {
+    if(length < MIDI_VELOCITY_FILE_SIZE) return false;
+    if(memcmp(data, MIDI_VELOCITY_FILE_MAGIC, 4) != 0) return false;
+    if((data[4] | (data[5] << 8)) != MIDI_VELOCITY_FILE_VERSION) return false;
+    if((data[6] | (data[7] << 8)) != MIDI_VELOCITY_LUT_SIZE) return false;
+
+    const uint8_t* table = &data[8];
+    if(table[0] != 0) return false;
+    for(size_t i = 1; i < MIDI_VELOCITY_LUT_SIZE; i++) {
+        if(table[i] == 0 || table[i] > 127) return false;
+    }
+    memcpy(lut, table, MIDI_VELOCITY_LUT_SIZE);
+    return true;
+}
+
+#endif // MIDI_FEATURE_OUTPUT
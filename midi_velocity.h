@@ -0,0 +1,61 @@
+#pragma once
+
+// Velocity calibration: a histogram of the velocities someone plays is turned
+// into a 128-entry lookup table that spreads them over a target curve. With
+// the uniform target this is histogram equalization: a keyboard that only
+// produces velocities 50..90 then covers the whole range. Applying the table
+// is one lookup per Note On (midi_thru.h).
+//
+// Every bin starts with a count of one, so bins that were never hit give a
+// gentle slope instead of a jump, and an empty histogram gives the identity.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIDI_VELOCITY_LUT_SIZE 128
+#define MIDI_VELOCITY_FILE_MAGIC "MVEL"
+#define MIDI_VELOCITY_FILE_VERSION 1
+#define MIDI_VELOCITY_FILE_SIZE (8 + MIDI_VELOCITY_LUT_SIZE) // Magic, version, size, table
+
+typedef struct {
+    uint32_t count[MIDI_VELOCITY_LUT_SIZE]; // Note On velocities 1..127 (0 is Note Off)
+    uint32_t total;
+} MidiVelocityHistogram;
+
+// Output distribution: low + (high - low) * p^gamma for the velocity at rank p
+typedef struct {
+    const char* name;
+    uint8_t low;
+    uint8_t high;
+    float gamma; // 1 = even spread, > 1 softer, < 1 harder
+} MidiVelocityTarget;
+
+extern const MidiVelocityTarget midi_velocity_targets[];
+extern const size_t midi_velocity_target_count;
+
+void midi_velocity_histogram_reset(MidiVelocityHistogram* histogram);
+void midi_velocity_histogram_add(MidiVelocityHistogram* histogram, uint8_t velocity);
+
+void midi_velocity_lut_identity(uint8_t* lut);
+// Monotonic table from the histogram; lut[0] stays 0 (Note Off)
+void midi_velocity_lut_build(
+    const MidiVelocityHistogram* histogram,
+    const MidiVelocityTarget* target,
+    uint8_t* lut);
+
+static inline uint8_t midi_velocity_apply(const uint8_t* lut, uint8_t velocity) {
+    return lut[velocity & 0x7F];
+}
+
+// File image (MIDI_VELOCITY_FILE_SIZE bytes) and back; decode rejects bad magic/version/values
+void midi_velocity_lut_encode(const uint8_t* lut, uint8_t* out);
+bool midi_velocity_lut_decode(const uint8_t* data, size_t length, uint8_t* lut);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,622 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_VIEWS
+
+#include "midi_app.h"
+
+#define VIEW_LINES 3 // Text lines between header and navigation hint
+#define VIEW_FIRST_LINE 31
+#define VIEW_LINE_HEIGHT 9
+#define MONITOR_READ_TRIES 3 // Give up on a torn read (writer preempted) and keep the last message
+
+void midi_monitor_publish(MidiMonitorSlot* slot, const MidiMessage* message, uint32_t arrival) {
+    slot->sequence++;
+    __DMB();
+    slot->message = *message;
+    slot->arrival = arrival;
+    __DMB();
+    slot->sequence++;
+}
+
+static bool midi_monitor_read(
+    const MidiMonitorSlot* slot,
+    MidiMessage* message,
+    uint32_t* arrival,
+    uint32_t* sequence) {
+    for(uint8_t i = 0; i < MONITOR_READ_TRIES; i++) {
+        uint32_t before = slot->sequence;
+        __DMB();
+        *message = slot->message;
+        *arrival = slot->arrival;
+        __DMB();
+        if(!(before & 1) && before == slot->sequence) {
+            *sequence = before;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Fast monitor: only the newest message, in large type, drawn without the app mutex
+void midi_view_monitor_draw(Canvas* canvas, MidiApp* app) {
+    char buffer[32];
+    uint32_t arrival = 0;
+    uint32_t sequence = app->monitor_drawn;
+
+    if(app->latency_reset) {
+        midi_latency_reset(&app->latency_history);
+        midi_latency_reset(&app->latency_monitor);
+        app->latency_reset = false;
+    }
+
+    MidiMessage message;
+    bool fresh = midi_monitor_read(&app->monitor, &message, &arrival, &sequence) &&
+                 sequence != app->monitor_drawn;
+    if(fresh) app->monitor_shown = message;
+
+    canvas_set_font(canvas, FontSecondary);
+    canvas_draw_str(canvas, 1, 8, "Fast monitor");
+
+    if(sequence == 0) {
+        canvas_draw_str_aligned(canvas, 64, 30, AlignCenter, AlignTop, "Waiting for MIDI...");
+    } else {
+        // "NoteOn  Ch01" on the first line, the values below
+        midi_format_message(&app->monitor_shown, buffer, sizeof(buffer));
+        const char* values = "";
+        if(strlen(buffer) > 12) {
+            buffer[12] = '\0';
+            values = &buffer[13];
+        }
+        canvas_set_font(canvas, FontPrimary);
+        canvas_draw_str(canvas, 1, 24, buffer);
+        canvas_draw_str(canvas, 1, 38, values);
+    }
+
+    canvas_set_font(canvas, FontSecondary);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Fast  %lu/%lu us",
+        (unsigned long)midi_latency_avg(&app->latency_monitor),
+        (unsigned long)app->latency_monitor.max);
+    canvas_draw_str(canvas, 1, 52, buffer);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Hist  %lu/%lu us",
+        (unsigned long)midi_latency_avg(&app->latency_history),
+        (unsigned long)app->latency_history.max);
+    canvas_draw_str(canvas, 1, 62, buffer);
+    canvas_draw_str_aligned(canvas, 118, 62, AlignRight, AlignBottom, "avg/max");
+
+    // Arrival to end of draw; the GUI commits the frame to the display right after
+    if(fresh) {
+        midi_latency_add(&app->latency_monitor, midi_cycles_to_us(midi_cycles() - arrival));
+        app->monitor_drawn = sequence;
+    }
+}
+
+// OK resets the latency statistics of both modes
+void midi_view_monitor_input(MidiApp* app, const InputEvent* input) {
+    if(input->type == InputTypePress && input->key == InputKeyOk) {
+        app->latency_reset = true;
+    }
+}
+
+#if MIDI_FEATURE_ANALYZERS
+
+// Changed parameters: only dirty entries of the parameter table
+void midi_view_params_draw(Canvas* canvas, MidiApp* app) {
+    MidiState* state = app->state;
+    const MidiParamTable* table = &state->params;
+    char buffer[32];
+
+    size_t dirty = midi_param_table_dirty_count(table);
+    if(state->params_scroll > dirty) state->params_scroll = dirty;
+
+    canvas_set_font(canvas, FontSecondary);
+    snprintf(buffer, sizeof(buffer), "Changed %u/%u", (unsigned)dirty, (unsigned)table->count);
+    canvas_draw_str(canvas, 1, 22, buffer);
+    if(state->param_checksum_errors) {
+        snprintf(buffer, sizeof(buffer), "CS err %lu", (unsigned long)state->param_checksum_errors);
+        canvas_draw_str_aligned(canvas, 118, 22, AlignRight, AlignBottom, buffer);
+    }
+
+    canvas_set_font(canvas, FontKeyboard);
+    uint8_t y = VIEW_FIRST_LINE;
+    size_t shown = 0;
+    size_t skipped = 0;
+    for(size_t i = midi_param_table_next_dirty(table, 0); i < table->capacity && shown < VIEW_LINES;
+        i = midi_param_table_next_dirty(table, i + 1)) {
+        if(skipped++ < state->params_scroll) continue;
+        const MidiParamEntry* entry = &table->entries[i];
+        midi_param_format(
+            midi_param_key_manufacturer(entry->key),
+            midi_param_key_address(entry->key),
+            entry->address_size,
+            entry->value,
+            buffer,
+            sizeof(buffer));
+        canvas_draw_str(canvas, 1, y, buffer);
+        y += VIEW_LINE_HEIGHT;
+        shown++;
+    }
+
+    if(dirty == 0) {
+        canvas_set_font(canvas, FontSecondary);
+        canvas_draw_str_aligned(canvas, 64, 36, AlignCenter, AlignTop, "No changed parameters");
+    }
+}
+
+// Up/Down scroll, OK marks everything as seen
+void midi_view_params_input(MidiApp* app, const InputEvent* input) {
+    MidiState* state = app->state;
+    if(input->type != InputTypePress && input->type != InputTypeRepeat) return;
+
+    switch(input->key) {
+    case InputKeyUp:
+        if(state->params_scroll > 0) state->params_scroll--;
+        break;
+    case InputKeyDown:
+        if((size_t)state->params_scroll + VIEW_LINES < midi_param_table_dirty_count(&state->params)) {
+            state->params_scroll++;
+        }
+        break;
+    case InputKeyOk:
+        midi_param_table_clear_dirty(&state->params);
+        state->params_scroll = 0;
+        break;
+    default:
+        break;
+    }
+}
+
+// Channel activity: 16 bars, levels decayed from the last hit at draw time
+#define METER_BAR_WIDTH 6
+#define METER_BAR_PITCH 7
+#define METER_TOP 14
+#define METER_BOTTOM 52 // Baseline, channel ticks below
+
+void midi_view_meters_draw(Canvas* canvas, MidiApp* app) {
+    const MidiMeters* meters = &app->state->meters;
+    uint32_t now = furi_get_tick();
+    uint8_t height_max = METER_BOTTOM - METER_TOP;
+
+    canvas_draw_line(canvas, 1, METER_BOTTOM, 1 + 16 * METER_BAR_PITCH - 2, METER_BOTTOM);
+    for(uint8_t channel = 0; channel < MIDI_METER_CHANNELS; channel++) {
+        uint8_t x = 1 + channel * METER_BAR_PITCH;
+        uint8_t level = midi_meters_level(meters, channel, now);
+        uint8_t height = (level * height_max) / MIDI_METER_MAX;
+        if(height) canvas_draw_box(canvas, x, METER_BOTTOM - height, METER_BAR_WIDTH, height);
+        if(channel % 4 == 0) canvas_draw_dot(canvas, x, METER_BOTTOM + 1);
+    }
+}
+
+// Jittery controls: controllers whose recent changes are mostly ±1 reversals.
+// OK switches the hysteresis stage of the thru on and off.
+void midi_view_jitter_draw(Canvas* canvas, MidiApp* app) {
+    MidiState* state = app->state;
+    const MidiJitter* jitter = &state->jitter;
+    char buffer[32];
+
+    size_t count = midi_jitter_count(jitter);
+    if(state->jitter_scroll > count) state->jitter_scroll = count;
+
+    canvas_set_font(canvas, FontSecondary);
+    snprintf(buffer, sizeof(buffer), "Jittery %u", (unsigned)count);
+    canvas_draw_str(canvas, 1, 22, buffer);
+#if MIDI_FEATURE_OUTPUT
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Filter %s %lu",
+        app->thru.hysteresis ? "on" : "off",
+        (unsigned long)app->thru.suppressed);
+    canvas_draw_str_aligned(canvas, 118, 22, AlignRight, AlignBottom, buffer);
+#endif
+
+    canvas_set_font(canvas, FontKeyboard);
+    uint8_t y = VIEW_FIRST_LINE;
+    size_t shown = 0;
+    size_t skipped = 0;
+    for(size_t i = midi_jitter_next(jitter, 0); i < 16 * 128 && shown < VIEW_LINES;
+        i = midi_jitter_next(jitter, i + 1)) {
+        if(skipped++ < state->jitter_scroll) continue;
+        uint8_t channel = i >> 7;
+        uint8_t controller = i & 0x7F;
+        snprintf(
+            buffer,
+            sizeof(buffer),
+            "Ch%02u CC#%03u %3u%%",
+            channel + 1,
+            controller,
+            (unsigned)midi_jitter_score(jitter, channel, controller) * 100 / MIDI_JITTER_SCORE_MAX);
+        canvas_draw_str(canvas, 1, y, buffer);
+        y += VIEW_LINE_HEIGHT;
+        shown++;
+    }
+
+    if(count == 0) {
+        canvas_set_font(canvas, FontSecondary);
+        canvas_draw_str_aligned(canvas, 64, 36, AlignCenter, AlignTop, "No jittery controls");
+    }
+}
+
+void midi_view_jitter_input(MidiApp* app, const InputEvent* input) {
+    MidiState* state = app->state;
+    if(input->type != InputTypePress && input->type != InputTypeRepeat) return;
+
+    switch(input->key) {
+    case InputKeyUp:
+        if(state->jitter_scroll > 0) state->jitter_scroll--;
+        break;
+    case InputKeyDown:
+        if((size_t)state->jitter_scroll + VIEW_LINES < midi_jitter_count(&state->jitter)) {
+            state->jitter_scroll++;
+        }
+        break;
+#if MIDI_FEATURE_OUTPUT
+    case InputKeyOk:
+        if(input->type == InputTypePress) app->thru.hysteresis = !app->thru.hysteresis;
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+#endif // MIDI_FEATURE_ANALYZERS
+
+#if MIDI_FEATURE_DIAGNOSTICS
+
+// Event queue sizing: queue length in use and the one recommended from the
+// bursts of all sessions (allocated on the next start), then this session's
+// largest burst (events queued plus lost), the time to drain a burst
+// (avg/max) and the shortest gap between bursts.
+static void midi_view_queue_draw(Canvas* canvas, MidiApp* app) {
+    const MidiQueueStats* stats = &app->queue_stats;
+    char buffer[32];
+
+    canvas_set_font(canvas, FontSecondary);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Queue %lu next %lu",
+        (unsigned long)stats->capacity,
+        (unsigned long)midi_queue_stats_recommend(
+            stats, MIDI_EVENT_QUEUE_MIN, MIDI_EVENT_QUEUE_MAX));
+    canvas_draw_str(canvas, 1, 22, buffer);
+
+    canvas_set_font(canvas, FontKeyboard);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Peak%lu Lost%lu",
+        (unsigned long)stats->high_water,
+        (unsigned long)app->queue_dropped);
+    canvas_draw_str(canvas, 1, VIEW_FIRST_LINE, buffer);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Drain %lu/%luus",
+        (unsigned long)midi_cycles_to_us(midi_latency_avg(&stats->drain)),
+        (unsigned long)midi_cycles_to_us(stats->drain.max));
+    canvas_draw_str(canvas, 1, VIEW_FIRST_LINE + VIEW_LINE_HEIGHT, buffer);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Bursts%lu Gap%lums",
+        (unsigned long)stats->bursts,
+        (unsigned long)(stats->gap.count ? stats->gap.min : 0));
+    canvas_draw_str(canvas, 1, VIEW_FIRST_LINE + 2 * VIEW_LINE_HEIGHT, buffer);
+}
+
+// Last main loop stall (from this or an earlier session): what the loop was
+// doing, who held the app mutex and how full the queue was. Up/Down switch
+// to the queue sizing page, OK clears the page shown.
+void midi_view_diagnostics_draw(Canvas* canvas, MidiApp* app) {
+    const MidiPostMortem* record = &app->postmortem;
+    char buffer[32];
+
+    if(app->state->diagnostics_queue) {
+        midi_view_queue_draw(canvas, app);
+        return;
+    }
+
+    canvas_set_font(canvas, FontSecondary);
+    if(!app->postmortem_valid) {
+        canvas_draw_str(canvas, 1, 22, "No stalls");
+        snprintf(
+            buffer,
+            sizeof(buffer),
+            "Session: %lu stalls, %lu lost",
+            (unsigned long)app->watchdog.stalls,
+            (unsigned long)app->queue_dropped);
+        canvas_draw_str(canvas, 1, VIEW_FIRST_LINE + VIEW_LINE_HEIGHT, buffer);
+        return;
+    }
+
+    snprintf(buffer, sizeof(buffer), "Stall %lums", (unsigned long)record->stalled_ms);
+    canvas_draw_str(canvas, 1, 22, buffer);
+    canvas_draw_str_aligned(
+        canvas, 118, 22, AlignRight, AlignBottom, record->recovered ? "recovered" : "hung");
+
+    canvas_set_font(canvas, FontKeyboard);
+    snprintf(
+        buffer, sizeof(buffer), "Loop %s %lums", record->stage, (unsigned long)record->stage_ms);
+    canvas_draw_str(canvas, 1, VIEW_FIRST_LINE, buffer);
+    snprintf(buffer, sizeof(buffer), "Lock %s", record->owner[0] ? record->owner : "free");
+    canvas_draw_str(canvas, 1, VIEW_FIRST_LINE + VIEW_LINE_HEIGHT, buffer);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Q%lu Lost%lu Rec%lu",
+        (unsigned long)record->queue_depth,
+        (unsigned long)record->queue_dropped,
+        (unsigned long)record->capture_pending);
+    canvas_draw_str(canvas, 1, VIEW_FIRST_LINE + 2 * VIEW_LINE_HEIGHT, buffer);
+}
+
+void midi_view_diagnostics_input(MidiApp* app, const InputEvent* input) {
+    if(input->type != InputTypePress) return;
+
+    switch(input->key) {
+    case InputKeyUp:
+    case InputKeyDown:
+        app->state->diagnostics_queue = !app->state->diagnostics_queue;
+        break;
+    case InputKeyOk:
+        if(app->state->diagnostics_queue) {
+            midi_diag_queue_clear(app);
+        } else {
+            midi_diag_clear(app);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+#endif // MIDI_FEATURE_DIAGNOSTICS
+
+#if MIDI_FEATURE_OUTPUT
+
+#define VELOCITY_TOP 25
+#define VELOCITY_BOTTOM 52 // Baseline of histogram and curve
+#define VELOCITY_CURVE_X 66 // Curve plot right of the histogram, both 64 px wide
+
+// Velocity calibration: OK starts collecting Note On velocities, OK again
+// derives the curve for the chosen target, installs it in the thru and saves
+// it. Down picks the target (rebuilt at once if there is data), Up turns the
+// curve off.
+void midi_view_velocity_draw(Canvas* canvas, MidiApp* app) {
+    const MidiState* state = app->state;
+    const MidiVelocityHistogram* histogram = &state->velocity_histogram;
+    char buffer[32];
+
+    canvas_set_font(canvas, FontSecondary);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "%s %s",
+        midi_velocity_targets[state->velocity_target].name,
+        state->velocity_collecting ? "rec" : (app->thru.velocity ? "on" : "off"));
+    canvas_draw_str(canvas, 1, 22, buffer);
+    snprintf(buffer, sizeof(buffer), "%lu notes", (unsigned long)histogram->total);
+    canvas_draw_str_aligned(canvas, 118, 22, AlignRight, AlignBottom, buffer);
+
+    // Histogram, two velocities per column
+    uint8_t height_max = VELOCITY_BOTTOM - VELOCITY_TOP;
+    uint32_t peak = 1;
+    for(uint8_t v = 0; v < MIDI_VELOCITY_LUT_SIZE; v += 2) {
+        uint32_t bin = histogram->count[v] + histogram->count[v + 1];
+        if(bin > peak) peak = bin;
+    }
+    for(uint8_t v = 0; v < MIDI_VELOCITY_LUT_SIZE; v += 2) {
+        uint32_t bin = histogram->count[v] + histogram->count[v + 1];
+        uint8_t height = bin * height_max / peak;
+        if(height) canvas_draw_line(canvas, v / 2, VELOCITY_BOTTOM, v / 2, VELOCITY_BOTTOM - height);
+    }
+    canvas_draw_line(canvas, 0, VELOCITY_BOTTOM, 63, VELOCITY_BOTTOM);
+
+    // Installed curve (the identity when off)
+    canvas_draw_frame(canvas, VELOCITY_CURVE_X - 1, VELOCITY_TOP - 1, 66, height_max + 2);
+    for(uint8_t v = 0; v < MIDI_VELOCITY_LUT_SIZE; v += 2) {
+        uint8_t out = app->thru.velocity ? app->thru.velocity[v] : v;
+        canvas_draw_dot(
+            canvas, VELOCITY_CURVE_X + v / 2, VELOCITY_BOTTOM - out * height_max / 127);
+    }
+}
+
+static void midi_view_velocity_install(MidiApp* app) {
+    MidiState* state = app->state;
+    uint8_t lut[MIDI_VELOCITY_LUT_SIZE];
+    midi_velocity_lut_build(
+        &state->velocity_histogram, &midi_velocity_targets[state->velocity_target], lut);
+    // The receive path may see a mix of old and new entries for a moment, never a bad one
+    memcpy(app->velocity_lut, lut, sizeof(lut));
+    app->thru.velocity = app->velocity_lut;
+    app->velocity_store = MidiVelocityStoreSave; // SD write after the mutex is released
+}
+
+void midi_view_velocity_input(MidiApp* app, const InputEvent* input) {
+    MidiState* state = app->state;
+    if(input->type != InputTypePress) return;
+
+    switch(input->key) {
+    case InputKeyOk:
+        if(state->velocity_collecting) {
+            state->velocity_collecting = false;
+            midi_view_velocity_install(app);
+        } else {
+            midi_velocity_histogram_reset(&state->velocity_histogram);
+            state->velocity_collecting = true;
+        }
+        break;
+    case InputKeyDown:
+        state->velocity_target = (state->velocity_target + 1) % midi_velocity_target_count;
+        if(!state->velocity_collecting && state->velocity_histogram.total) {
+            midi_view_velocity_install(app);
+        }
+        break;
+    case InputKeyUp:
+        state->velocity_collecting = false;
+        app->thru.velocity = NULL;
+        app->velocity_store = MidiVelocityStoreRemove;
+        break;
+    default:
+        break;
+    }
+}
+
+static const uint8_t playout_percentiles[] = {80, 90, 95, 99};
+
+// Playout buffer on the DIN thru: OK starts/stops, Up/Down pick the share of
+// the transit jitter the delay covers (more: less residual jitter, more delay)
+void midi_view_playout_draw(Canvas* canvas, MidiApp* app) {
+    char buffer[32];
+
+    canvas_set_font(canvas, FontSecondary);
+    if(!app->din) {
+        canvas_draw_str_aligned(canvas, 64, 36, AlignCenter, AlignTop, "USART in use");
+        return;
+    }
+
+    const MidiPlayout* playout = midi_din_playout(app->din);
+    uint32_t target_us = midi_playout_target_us(playout);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Playout %s p%u",
+        midi_din_playout_is_running(app->din) ? "on" : "off",
+        app->state->playout_percentile);
+    canvas_draw_str(canvas, 1, 22, buffer);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "%lu.%lums",
+        (unsigned long)(target_us / 1000),
+        (unsigned long)(target_us % 1000 / 100));
+    canvas_draw_str_aligned(canvas, 118, 22, AlignRight, AlignBottom, buffer);
+
+    canvas_set_font(canvas, FontKeyboard);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Add %lu/%luus",
+        (unsigned long)midi_latency_avg(&playout->added_us),
+        (unsigned long)playout->added_us.max);
+    canvas_draw_str(canvas, 1, VIEW_FIRST_LINE, buffer);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Jit %lu/%luus",
+        (unsigned long)midi_latency_avg(&playout->residual_us),
+        (unsigned long)playout->residual_us.max);
+    canvas_draw_str(canvas, 1, VIEW_FIRST_LINE + VIEW_LINE_HEIGHT, buffer);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Late%lu Full%lu",
+        (unsigned long)playout->late,
+        (unsigned long)playout->overflow);
+    canvas_draw_str(canvas, 1, VIEW_FIRST_LINE + 2 * VIEW_LINE_HEIGHT, buffer);
+}
+
+void midi_view_playout_input(MidiApp* app, const InputEvent* input) {
+    MidiState* state = app->state;
+    if(!app->din || input->type != InputTypePress) return;
+
+    size_t count = sizeof(playout_percentiles) / sizeof(playout_percentiles[0]);
+    size_t index = 0;
+    while(index < count - 1 && playout_percentiles[index] < state->playout_percentile) index++;
+
+    switch(input->key) {
+    case InputKeyOk:
+        if(midi_din_playout_is_running(app->din)) {
+            midi_din_playout_stop(app->din);
+        } else {
+            midi_din_playout_start(app->din, state->playout_percentile);
+        }
+        return;
+    case InputKeyUp:
+        if(index < count - 1) index++;
+        break;
+    case InputKeyDown:
+        if(index > 0) index--;
+        break;
+    default:
+        return;
+    }
+
+    state->playout_percentile = playout_percentiles[index];
+    if(midi_din_playout_is_running(app->din)) {
+        midi_din_playout_start(app->din, state->playout_percentile); // Restart with the new setting
+    }
+}
+
+// DIN link test: loop DIN OUT back to DIN IN (or pin 13 to pin 14), OK starts/stops
+void midi_view_link_test_draw(Canvas* canvas, MidiApp* app) {
+    char buffer[32];
+
+    canvas_set_font(canvas, FontSecondary);
+    if(!app->din) {
+        canvas_draw_str_aligned(canvas, 64, 36, AlignCenter, AlignTop, "USART in use");
+        return;
+    }
+
+    const MidiLinkTest* link = midi_din_link_test(app->din);
+    bool running = midi_din_link_test_is_running(app->din);
+    uint32_t ppm = midi_link_test_error_ppm(link);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Link %s  BER %lu.%04lu%%",
+        running ? "run" : "stop",
+        (unsigned long)(ppm / 10000),
+        (unsigned long)(ppm % 10000));
+    canvas_draw_str(canvas, 1, 22, buffer);
+
+    canvas_set_font(canvas, FontKeyboard);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Tx%lu Rx%lu",
+        (unsigned long)link->sent,
+        (unsigned long)link->received);
+    canvas_draw_str(canvas, 1, VIEW_FIRST_LINE, buffer);
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "Err%lu Lost%lu Fr%lu",
+        (unsigned long)link->errors,
+        (unsigned long)link->lost,
+        (unsigned long)link->framing_errors);
+    canvas_draw_str(canvas, 1, VIEW_FIRST_LINE + VIEW_LINE_HEIGHT, buffer);
+    if(link->latency_count) {
+        snprintf(
+            buffer,
+            sizeof(buffer),
+            "Lat %lu/%lu/%luus",
+            (unsigned long)link->latency_min_us,
+            (unsigned long)midi_link_test_latency_avg_us(link),
+            (unsigned long)link->latency_max_us);
+    } else {
+        snprintf(buffer, sizeof(buffer), "OK: start test");
+    }
+    canvas_draw_str(canvas, 1, VIEW_FIRST_LINE + 2 * VIEW_LINE_HEIGHT, buffer);
+}
+
+void midi_view_link_test_input(MidiApp* app, const InputEvent* input) {
+    if(!app->din || input->type != InputTypePress || input->key != InputKeyOk) return;
+
+    if(midi_din_link_test_is_running(app->din)) {
+        midi_din_link_test_stop(app->din);
+    } else {
+        midi_din_link_test_start(app->din);
+    }
+}
+
+#endif // MIDI_FEATURE_OUTPUT
+
+#endif // MIDI_FEATURE_VIEWS
@@ -0,0 +1,126 @@
+#include "midi_config.h"
+
+#if MIDI_FEATURE_DIAGNOSTICS
+
+#include "midi_watchdog.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static inline void put_le16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static inline void put_le32(uint8_t* out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = value >> 24;
+}
+
+static inline uint16_t get_le16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+static inline uint32_t get_le32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+void midi_watchdog_init(MidiWatchdog* watchdog, uint32_t deadline, uint32_t now) {
+    memset(watchdog, 0, sizeof(MidiWatchdog));
+    watchdog->deadline = deadline;
+    watchdog->kicked = now;
+}
+
+MidiWatchdogState midi_watchdog_check(MidiWatchdog* watchdog, uint32_t now, uint32_t pending) {
+    // An idle loop waiting on an empty queue is fine however long it waits
+    bool late = pending > 0 && now - watchdog->kicked > watchdog->deadline;
+
+    if(watchdog->stalled) {
+        if(late) return MidiWatchdogStalling;
+        watchdog->stalled = false;
+        return MidiWatchdogRecovered;
+    }
+    if(!late) return MidiWatchdogOk;
+
+    watchdog->stalled = true;
+    watchdog->stall_start = watchdog->kicked;
+    watchdog->stalls++;
+    return MidiWatchdogStalled;
+}
+
+uint32_t midi_watchdog_stall_ms(const MidiWatchdog* watchdog, uint32_t now) {
+    uint32_t end = watchdog->stalled ? now : watchdog->kicked;
+    return end - watchdog->stall_start;
+}
+
+void midi_postmortem_encode(const MidiPostMortem* record, uint8_t* out) {
+    memcpy(out, MIDI_POSTMORTEM_MAGIC, 4);
+    put_le16(&out[4], MIDI_POSTMORTEM_VERSION);
+    put_le16(&out[6], MIDI_POSTMORTEM_SIZE);
+    put_le32(&out[8], record->time);
+    put_le32(&out[12], record->stalled_ms);
+    put_le32(&out[16], record->stage_ms);
+    put_le32(&out[20], record->render_ms);
+    put_le32(&out[24], record->queue_depth);
+    put_le32(&out[28], record->queue_dropped);
+    put_le32(&out[32], record->capture_pending);
+    memcpy(&out[36], record->stage, MIDI_POSTMORTEM_NAME);
+    memcpy(&out[36 + MIDI_POSTMORTEM_NAME], record->render, MIDI_POSTMORTEM_NAME);
+    memcpy(&out[36 + 2 * MIDI_POSTMORTEM_NAME], record->owner, MIDI_POSTMORTEM_NAME);
+    out[36 + 3 * MIDI_POSTMORTEM_NAME] = record->recovered;
+}
+
+bool midi_postmortem_decode(const uint8_t* data, size_t length, MidiPostMortem* record) {
+    if(length < MIDI_POSTMORTEM_SIZE) return false;
+    if(memcmp(data, MIDI_POSTMORTEM_MAGIC, 4) != 0) return false;
+    if(get_le16(&data[4]) != MIDI_POSTMORTEM_VERSION) return false;
+    if(get_le16(&data[6]) != MIDI_POSTMORTEM_SIZE) return false;
+
+    record->time = get_le32(&data[8]);
+    record->stalled_ms = get_le32(&data[12]);
+    record->stage_ms = get_le32(&data[16]);
+    record->render_ms = get_le32(&data[20]);
+    record->queue_depth = get_le32(&data[24]);
+    record->queue_dropped = get_le32(&data[28]);
+    record->capture_pending = get_le32(&data[32]);
+    memcpy(record->stage, &data[36], MIDI_POSTMORTEM_NAME);
+    memcpy(record->render, &data[36 + MIDI_POSTMORTEM_NAME], MIDI_POSTMORTEM_NAME);
+    memcpy(record->owner, &data[36 + 2 * MIDI_POSTMORTEM_NAME], MIDI_POSTMORTEM_NAME);
+    record->recovered = data[36 + 3 * MIDI_POSTMORTEM_NAME] != 0;
+    // Names come from the file: make sure they end
+    record->stage[MIDI_POSTMORTEM_NAME - 1] = '\0';
+    record->render[MIDI_POSTMORTEM_NAME - 1] = '\0';
+    record->owner[MIDI_POSTMORTEM_NAME - 1] = '\0';
+    return true;
+}
+
+size_t midi_postmortem_format(const MidiPostMortem* record, char* out, size_t size) {
+    int length = snprintf(
+        out,
+        size,
+        "stall_time: %lu\n"
+        "stall_ms: %lu%s\n"
+        "loop_stage: %s %lu ms\n"
+        "render_stage: %s %lu ms\n"
+        "lock_owner: %s\n"
+        "queue_depth: %lu\n"
+        "queue_dropped: %lu\n"
+        "capture_pending: %lu\n",
+        (unsigned long)record->time,
+        (unsigned long)record->stalled_ms,
+        record->recovered ? "" : " (not recovered)",
+        record->stage,
+        (unsigned long)record->stage_ms,
+        record->render,
+        (unsigned long)record->render_ms,
+        record->owner[0] ? record->owner : "-",
+        (unsigned long)record->queue_depth,
+        (unsigned long)record->queue_dropped,
+        (unsigned long)record->capture_pending);
+    if(length < 0) return 0;
+    return (size_t)length < size ? (size_t)length : size - 1;
+}
+
+#endif // MIDI_FEATURE_DIAGNOSTICS
@@ -0,0 +1,73 @@
+#pragma once
+
+// Main loop stall watchdog: the loop kicks it whenever it takes from the
+// event queue, a watchdog thread checks that it did so within a deadline
+// while events were waiting. On a stall the watchdog fills a post-mortem
+// record (what the loop was doing, who held the lock, queue depths) that is
+// kept on SD and shown on the next launch.
+//
+// Record file (little endian): "MPMR" | version u16 | size u16 | fields as
+// encoded by midi_postmortem_encode(). Times are milliseconds.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIDI_POSTMORTEM_MAGIC "MPMR"
+#define MIDI_POSTMORTEM_VERSION 1
+#define MIDI_POSTMORTEM_NAME 16 // Stage and thread names, NUL-terminated
+#define MIDI_POSTMORTEM_SIZE (8 + 7 * 4 + 3 * MIDI_POSTMORTEM_NAME + 1)
+
+typedef enum {
+    MidiWatchdogOk,
+    MidiWatchdogStalled,   // Deadline missed just now
+    MidiWatchdogStalling,  // Still stalled
+    MidiWatchdogRecovered, // The loop drained the queue again
+} MidiWatchdogState;
+
+typedef struct {
+    uint32_t deadline;  // Ms the loop may leave waiting events alone
+    uint32_t kicked;    // Last time the loop took from the queue
+    uint32_t stall_start;
+    bool stalled;
+    uint32_t stalls;    // Since init
+} MidiWatchdog;
+
+typedef struct {
+    uint32_t time;          // Unix time of the stall, 0 if unknown
+    uint32_t stalled_ms;    // Time without draining; final once recovered
+    uint32_t stage_ms;      // Time in the loop stage at detection
+    uint32_t render_ms;     // Time in the render stage at detection
+    uint32_t queue_depth;   // Events waiting
+    uint32_t queue_dropped; // Events lost to a full queue (session)
+    uint32_t capture_pending; // Capture records waiting for the SD write
+    char stage[MIDI_POSTMORTEM_NAME];  // Main loop stage
+    char render[MIDI_POSTMORTEM_NAME]; // GUI render stage
+    char owner[MIDI_POSTMORTEM_NAME];  // Thread holding the app mutex, "" if free
+    bool recovered;
+} MidiPostMortem;
+
+void midi_watchdog_init(MidiWatchdog* watchdog, uint32_t deadline, uint32_t now);
+
+static inline void midi_watchdog_kick(MidiWatchdog* watchdog, uint32_t now) {
+    watchdog->kicked = now;
+}
+
+// Called periodically with the number of events waiting
+MidiWatchdogState midi_watchdog_check(MidiWatchdog* watchdog, uint32_t now, uint32_t pending);
+// Length of the current or last stall
+uint32_t midi_watchdog_stall_ms(const MidiWatchdog* watchdog, uint32_t now);
+
+void midi_postmortem_encode(const MidiPostMortem* record, uint8_t* out);
+// Returns false if magic, version or size do not match
+bool midi_postmortem_decode(const uint8_t* data, size_t length, MidiPostMortem* record);
+// Human-readable "key: value" lines, returns the length written (without NUL)
+size_t midi_postmortem_format(const MidiPostMortem* record, char* out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,222 @@
+#!/usr/bin/env python3
+"""Per-module flash/RAM footprint of the mitzi_midi .fap.
+
+Measures the linked application, so code a disabled MIDI_FEATURE_* removed
+or the linker dropped is not counted, and groups it by the feature modules
+from midi_config.h:
+
+    ufbt
+    python3 tools/size_report.py ~/.ufbt/build/mitzi_midi
+
+The argument is a build directory or a linked file. A linker map (*.map,
+from -Wl,-Map) is used if there is one: every input section kept in the
+output is charged to its object file. Otherwise the symbols of the linked
+ELF (the debug image *_d.elf, else the .fap) are charged to their source
+file with `arm-none-eabi-nm -S -l`; this needs debug info, and whatever
+cannot be attributed is listed as "other".
+
+Pass a second build with --compare to diff e.g. a lean build (all
+MIDI_FEATURE_* = 0) against the full one.
+
+Flash = .text + .rodata + .data (initialised data is stored in the image),
+RAM   = .data + .bss. Heap allocated at runtime (MidiState etc.) is not shown.
+"""
+
+import argparse
+import pathlib
+import subprocess
+import sys
+
+# Object/source file stem -> feature module. Anything not listed is counted as "app".
+MODULES = {
+    "midi": "app",
+    "midi_store": "app",
+    "midi_core": "core",
+    "midi_capture": "core",
+    "midi_param": "core",
+    "midi_universal": "core",
+    "midi_profile": "core",
+    "midi_recorder": "recorder",
+    "midi_trace": "recorder",
+    "midi_meter": "analyzers",
+    "midi_jitter": "analyzers",
+    "midi_thru": "output",
+    "midi_playout": "output",
+    "midi_velocity": "output",
+    "midi_link_test": "output",
+    "midi_din": "output",
+    "midi_views": "views",
+    "midi_bus": "service",
+    "midi_service": "service",
+    "midi_watchdog": "diagnostics",
+    "midi_queue_stats": "diagnostics",
+    "midi_diag": "diagnostics",
+}
+
+MODULE_ORDER = [
+    "app",
+    "core",
+    "recorder",
+    "analyzers",
+    "output",
+    "views",
+    "service",
+    "diagnostics",
+    "other",
+]
+
+
+def section_class(name):
+    """(flash, ram) weights of an output section, None if it is not loaded."""
+    if name.startswith((".text", ".rodata")):
+        return 1, 0
+    if name.startswith(".data"):
+        return 1, 1
+    if name.startswith((".bss", "COMMON")):
+        return 0, 1
+    return None
+
+
+def add(modules, stem, flash, ram):
+    module = MODULES.get(stem, "app") if stem else "other"
+    total = modules.setdefault(module, [0, 0])
+    total[0] += flash
+    total[1] += ram
+
+
+def from_map(path):
+    """Input sections kept in the output, per object file (GNU ld map)."""
+    modules = {}
+    lines = pathlib.Path(path).read_text(errors="replace").splitlines()
+    try:
+        first = next(i for i, l in enumerate(lines) if l.startswith("Linker script and memory map"))
+    except StopIteration:
+        sys.exit(f"{path}: not a GNU ld map file")
+    pending = None  # Input section name on its own line, address/size/file follow
+    for line in lines[first + 1 :]:
+        parts = line.split()
+        if not line.startswith(" ") or not parts:
+            pending = None
+            continue
+        if len(parts) == 1 and line.startswith(" ."):
+            pending = parts[0]
+            continue
+        if pending and len(parts) >= 3 and parts[0].startswith("0x"):
+            name, address, size, obj = pending, parts[0], parts[1], parts[2]
+        elif len(parts) >= 4 and (parts[0].startswith(".") or parts[0] == "COMMON"):
+            name, address, size, obj = parts[0], parts[1], parts[2], parts[3]
+        else:
+            pending = None
+            continue
+        pending = None
+        weights = section_class(name)
+        if weights is None or not size.startswith("0x") or not obj.endswith(".o"):
+            continue
+        size = int(size, 16)
+        if size:
+            add(modules, pathlib.Path(obj.split("(")[0]).stem, size * weights[0], size * weights[1])
+    return modules
+
+
+def image_sizes(size_tool, image):
+    out = subprocess.run(
+        [size_tool, "-A", str(image)], check=True, capture_output=True, text=True
+    ).stdout
+    flash = ram = 0
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) < 2 or not parts[1].isdigit():
+            continue
+        weights = section_class(parts[0])
+        if weights:
+            flash += int(parts[1]) * weights[0]
+            ram += int(parts[1]) * weights[1]
+    return flash, ram
+
+
+def from_elf(image, size_tool, nm_tool):
+    """Symbols of the linked image, per source file (needs debug info)."""
+    out = subprocess.run(
+        [nm_tool, "-S", "-l", "--defined-only", str(image)],
+        check=True,
+        capture_output=True,
+        text=True,
+    ).stdout
+    modules = {}
+    flash = ram = 0
+    for line in out.splitlines():
+        fields = line.split("\t")
+        parts = fields[0].split()
+        if len(parts) < 4 or len(fields) < 2:
+            continue
+        size, kind = int(parts[1], 16), parts[2].lower()
+        weights = {"t": (1, 0), "r": (1, 0), "d": (1, 1), "b": (0, 1)}.get(kind)
+        if weights is None:
+            continue
+        stem = pathlib.Path(fields[1].rsplit(":", 1)[0]).stem
+        add(modules, stem, size * weights[0], size * weights[1])
+        flash += size * weights[0]
+        ram += size * weights[1]
+    total_flash, total_ram = image_sizes(size_tool, image)
+    add(modules, None, max(total_flash - flash, 0), max(total_ram - ram, 0))
+    return modules
+
+
+def find_linked(path):
+    path = pathlib.Path(path)
+    if path.is_file():
+        return path
+    for pattern in ("*.map", "*_d.elf", "*.fap", "*.elf"):
+        found = sorted(path.rglob(pattern))
+        if found:
+            return found[0]
+    sys.exit(f"no linked image (.map, .elf, .fap) found in {path}")
+
+
+def collect(path, size_tool, nm_tool):
+    linked = find_linked(path)
+    print(f"# {linked}", file=sys.stderr)
+    if linked.suffix == ".map":
+        return from_map(linked)
+    return from_elf(linked, size_tool, nm_tool)
+
+
+def ordered(names):
+    return sorted(names, key=lambda m: (MODULE_ORDER.index(m) if m in MODULE_ORDER else 99, m))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("build", help="build directory, linker map, .elf or .fap")
+    parser.add_argument("--compare", metavar="BUILD", help="second build to diff against")
+    parser.add_argument("--size-tool", default="arm-none-eabi-size")
+    parser.add_argument("--nm-tool", default="arm-none-eabi-nm")
+    args = parser.parse_args()
+
+    full = collect(args.build, args.size_tool, args.nm_tool)
+    other = collect(args.compare, args.size_tool, args.nm_tool) if args.compare else None
+
+    header = f"{'module':<10} {'flash':>8} {'ram':>8}"
+    if other is not None:
+        header += f" {'flash(cmp)':>11} {'ram(cmp)':>9}"
+    print(header)
+    totals = [0, 0, 0, 0]
+    for module in ordered(set(full) | set(other or {})):
+        flash, ram = full.get(module, (0, 0))
+        line = f"{module:<10} {flash:>8} {ram:>8}"
+        totals[0] += flash
+        totals[1] += ram
+        if other is not None:
+            cflash, cram = other.get(module, (0, 0))
+            line += f" {cflash:>11} {cram:>9}"
+            totals[2] += cflash
+            totals[3] += cram
+        print(line)
+    line = f"{'total':<10} {totals[0]:>8} {totals[1]:>8}"
+    if other is not None:
+        line += f" {totals[2]:>11} {totals[3]:>9}"
+    print(line)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+"""Convert a mitzi_midi timeline trace (.mtrc) to Chrome trace JSON.
+
+The app records a trace while capturing (Up button) and saves it next to the
+capture as capture_NNN.mtrc. Open the JSON in https://ui.perfetto.dev or
+chrome://tracing:
+
+    python3 tools/trace_export.py capture_000.mtrc -o capture_000.json
+
+Tracks: USB receive (transfers, decoded messages, queue overflows), main loop
+(app mutex held per event) and GUI (app mutex held by render_callback), plus
+a counter of events waiting in the queue. Timestamps are kernel milliseconds
+as in the capture file, so both can be read side by side. File format: see
+midi_trace.h.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = b"MTRC"
+VERSION = 2
+HEADER_V1 = struct.Struct("<4sHHII")
+HEADER = struct.Struct("<4sHHIII")  # Version 2 adds the full tick of the last clock
+EVENT = struct.Struct("<II")
+CLOCK_MASK = 0xFFFFFF  # Bits of the tick a clock instant carries
+
+INSTANT, BEGIN, END, COUNTER = range(4)
+
+# MidiTraceId -> (name, track)
+IDS = {
+    0: ("clock", 2),
+    1: ("USB transfer", 1),
+    2: ("MIDI in", 1),
+    3: ("queue full", 1),
+    4: ("queue", 0),
+    5: ("main loop lock", 2),
+    6: ("render lock", 3),
+}
+TRACKS = {1: "USB receive", 2: "Main loop", 3: "GUI"}
+EVENT_TYPES = ["key", "MIDI", "SysEx", "USB status"]  # EventType, main loop lock arg
+STATUS_NAMES = {
+    0x80: "Note Off",
+    0x90: "Note On",
+    0xA0: "Poly Pressure",
+    0xB0: "Control Change",
+    0xC0: "Program Change",
+    0xD0: "Channel Pressure",
+    0xE0: "Pitch Bend",
+}
+
+
+def read_trace(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < HEADER_V1.size:
+        sys.exit(f"{path}: too short")
+    magic, version, event_size, ticks_per_second, count = HEADER_V1.unpack_from(data)
+    if magic != MAGIC or version not in (1, VERSION) or event_size != EVENT.size:
+        sys.exit(f"{path}: not a version 1 or {VERSION} trace")
+    header = HEADER_V1
+    clock_tick = None
+    if version >= 2:
+        if len(data) < HEADER.size:
+            sys.exit(f"{path}: too short")
+        header = HEADER
+        clock_tick = HEADER.unpack_from(data)[5]
+    count = min(count, (len(data) - header.size) // EVENT.size)
+    events = []
+    for i in range(count):
+        time, word = EVENT.unpack_from(data, header.size + i * EVENT.size)
+        events.append((time, word & 0x03, (word >> 2) & 0x3F, word >> 8))
+    return ticks_per_second, clock_tick, events
+
+
+def unwrap(events):
+    """Extend the 32-bit cycle counter; the app records a clock well inside the wrap."""
+    times = []
+    total = None
+    previous = 0
+    for time, _, _, _ in events:
+        if total is None:
+            total = time
+        else:
+            delta = (time - previous) & 0xFFFFFFFF
+            total += delta - (1 << 32) if delta & 0x80000000 else delta
+        previous = time
+        times.append(total)
+    return times
+
+
+def message_event(arg):
+    status, data1, data2 = arg & 0xFF, (arg >> 8) & 0x7F, (arg >> 16) & 0x7F
+    if status >= 0xF0:
+        return f"System 0x{status:02X}", {"status": status, "data1": data1, "data2": data2}
+    name = STATUS_NAMES.get(status & 0xF0, f"0x{status:02X}")
+    return name, {"channel": (status & 0x0F) + 1, "data1": data1, "data2": data2}
+
+
+def full_tick(clock_tick, arg):
+    """Full kernel tick of a clock instant, from the header tick of the last one."""
+    if clock_tick is None:
+        return arg
+    return (clock_tick - ((clock_tick - arg) & CLOCK_MASK)) & 0xFFFFFFFF
+
+
+def convert(ticks_per_second, clock_tick, events):
+    times = unwrap(events)
+    # Anchor on the last clock so timestamps are kernel milliseconds. The app
+    # writes one when recording stops and its full tick into the header; the
+    # instant itself only keeps 24 bits, which wrap after 4.66 h of uptime.
+    offset_us = None
+    for (time, kind, ident, arg), total in zip(reversed(events), reversed(times)):
+        if kind == INSTANT and ident == 0:
+            if clock_tick is None:
+                print(
+                    "warning: version 1 trace, timestamps are off by a multiple of "
+                    f"{CLOCK_MASK + 1} ms after 4.66 h of uptime",
+                    file=sys.stderr,
+                )
+                tick = arg
+            else:
+                if arg != clock_tick & CLOCK_MASK:
+                    print("warning: last clock event does not match the header", file=sys.stderr)
+                tick = full_tick(clock_tick, arg)
+            offset_us = tick * 1000.0 - total * 1e6 / ticks_per_second
+            break
+    if offset_us is None:
+        print(
+            "warning: no clock event in the trace, timestamps start at 0 and do not "
+            "line up with the capture",
+            file=sys.stderr,
+        )
+        offset_us = -times[0] * 1e6 / ticks_per_second if times else 0.0
+
+    out = [{"name": "process_name", "ph": "M", "pid": 1, "args": {"name": "mitzi_midi"}}]
+    for tid, name in TRACKS.items():
+        out.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": tid, "args": {"name": name}})
+
+    open_spans = {}  # (track, id) -> nesting depth; the ring may have cut off a begin
+    last_ts = 0.0
+    for (time, kind, ident, arg), total in zip(events, times):
+        name, tid = IDS.get(ident, (f"event {ident}", 2))
+        ts = offset_us + total * 1e6 / ticks_per_second
+        last_ts = max(last_ts, ts)
+        record = {"name": name, "pid": 1, "tid": tid, "ts": round(ts, 3)}
+        if kind == INSTANT:
+            record.update(ph="i", s="t")
+            if ident == 2:
+                record["name"], record["args"] = message_event(arg)
+                record["cat"] = "midi"
+            elif ident == 3:
+                record["args"] = {"event": EVENT_TYPES[arg] if arg < len(EVENT_TYPES) else arg}
+            else:
+                record["args"] = {"tick_ms": full_tick(clock_tick, arg)}
+        elif kind == BEGIN:
+            open_spans[(tid, ident)] = open_spans.get((tid, ident), 0) + 1
+            record["ph"] = "B"
+            if ident == 1:
+                record["args"] = {"bytes": arg}
+            elif ident == 5:
+                record["args"] = {"event": EVENT_TYPES[arg] if arg < len(EVENT_TYPES) else arg}
+            elif ident == 6:
+                record["args"] = {"screen": arg}
+        elif kind == END:
+            if not open_spans.get((tid, ident)):
+                continue
+            open_spans[(tid, ident)] -= 1
+            record["ph"] = "E"
+        else:
+            record.update(ph="C", args={"events": arg})
+            del record["tid"]
+        out.append(record)
+
+    # Spans still open when recording stopped
+    for (tid, ident), depth in open_spans.items():
+        for _ in range(depth):
+            name = IDS.get(ident, (f"event {ident}", tid))[0]
+            out.append({"name": name, "ph": "E", "pid": 1, "tid": tid, "ts": round(last_ts, 3)})
+    return {"traceEvents": out, "displayTimeUnit": "ms"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("trace", help=".mtrc file saved by the app")
+    parser.add_argument("-o", "--output", help="JSON file to write (default: stdout)")
+    args = parser.parse_args()
+
+    ticks_per_second, clock_tick, events = read_trace(args.trace)
+    result = convert(ticks_per_second, clock_tick, events)
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(result, f)
+    else:
+        json.dump(result, sys.stdout)
+        sys.stdout.write("\n")
+    print(f"{len(events)} events", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()